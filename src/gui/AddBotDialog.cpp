@@ -1,6 +1,7 @@
 // This file is part of flobby (GPL v2 or later), see the LICENSE file
 
 #include "AddBotDialog.h"
+#include "Cache.h"
 #include "model/Model.h"
 
 #include <FL/Fl_Hold_Browser.H>
@@ -12,8 +13,9 @@
 #include <boost/lexical_cast.hpp>
 
 
-AddBotDialog::AddBotDialog(Model & model):
+AddBotDialog::AddBotDialog(Model & model, Cache & cache):
     model_(model),
+    cache_(cache),
     Fl_Window(600, 400, "Add AI")
 {
     set_modal();
@@ -135,7 +137,14 @@ void AddBotDialog::show(std::string const & game, std::string const & botName)
     buf_->remove(0, buf_->length());
     add_->deactivate();
 
-    ais_ = model_.getModAIs(game);
+    try
+    {
+        ais_ = cache_.getGameInfo(game).ais_;
+    }
+    catch (std::exception const & e)
+    {
+        ais_.clear();
+    }
     for (AI const & ai : ais_)
     {
         list_->add(ai.name_.c_str());
@@ -9,6 +9,7 @@
 #include <string>
 
 class Model;
+class Cache;
 class Fl_Hold_Browser;
 class Fl_Text_Display;
 class Fl_Text_Buffer;
@@ -18,13 +19,14 @@ class Fl_Return_Button;
 class AddBotDialog: public Fl_Window
 {
 public:
-    AddBotDialog(Model & model);
+    AddBotDialog(Model & model, Cache & cache);
     virtual ~AddBotDialog();
 
     void show(std::string const & game, std::string const & botName);
 
 private:
     Model & model_;
+    Cache & cache_;
     Fl_Hold_Browser * list_;
     Fl_Text_Display * info_;
     Fl_Text_Buffer * buf_;
@@ -7,6 +7,7 @@
 #include <FL/Fl_Input.H>
 #include <FL/Fl_Int_Input.H>
 #include <FL/Fl_Box.H>
+#include <FL/Fl_Check_Button.H>
 #include <FL/Fl_Return_Button.H>
 #include <FL/Fl.H>
 #include <FL/fl_ask.H>
@@ -19,15 +20,28 @@ BattleFilterDialog::BattleFilterDialog():
 {
     set_modal();
 
-    game_ = new Fl_Input(10, 30, 380, 30, "Game (e.g 'zero,nota')");
-    game_->align(FL_ALIGN_TOP_LEFT);
+    text_ = new Fl_Input(10, 30, 380, 30, "Filter (e.g 'zero,nota map:comet -is:locked')");
+    text_->align(FL_ALIGN_TOP_LEFT);
+    text_->maximum_size(256);
 
     players_ = new Fl_Int_Input(10, 100, 380, 30, "Minimum players");
     players_->align(FL_ALIGN_TOP_LEFT);
 
-    box_ = new Fl_Box(10, 170, 380, 30);
+    installed_ = new Fl_Check_Button(10, 150, 380, 30, "Only battles with game and map installed");
+
+    box_ = new Fl_Box(10, 190, 380, 30);
     box_->labelcolor(FL_RED);
 
+    Fl_Box * help = new Fl_Box(10, 225, 380, 115,
+        "Words match the game, other terms are\n"
+        "map:text engine:text title:text (title or host)\n"
+        "players:4-8 players:4- players:-8\n"
+        "is:running is:passworded is:locked\n"
+        "has:map has:game\n"
+        "A term starting with '-' must not match.");
+    help->align(FL_ALIGN_INSIDE | FL_ALIGN_TOP_LEFT);
+    help->labelsize(FL_NORMAL_SIZE - 2);
+
     Fl_Return_Button * btn = new Fl_Return_Button(280, 350, 110, 30, "Set filter");
     btn->callback(BattleFilterDialog::callback, this);
 
@@ -63,17 +77,18 @@ void BattleFilterDialog::onFilterSet()
         return;
     }
 
-    std::string gameFilter = game_->value();
-    boost::trim(gameFilter);
-    filterSetSignal_(gameFilter, players);
+    std::string text = text_->value();
+    boost::trim(text);
+    filterSetSignal_(text, players, installed_->value() != 0);
     box_->label(0);
     hide();
 }
 
-void BattleFilterDialog::show(std::string const & game, int players)
+void BattleFilterDialog::show(std::string const & text, int players, bool installed)
 {
-    game_->value(game.c_str());
+    text_->value(text.c_str());
     players_->value(boost::lexical_cast<std::string>(players).c_str());
+    installed_->value(installed ? 1 : 0);
     Fl_Window::show();
 }
 
@@ -9,6 +9,7 @@
 class Fl_Input;
 class Fl_Int_Input;
 class Fl_Box;
+class Fl_Check_Button;
 
 class BattleFilterDialog: public Fl_Window
 {
@@ -16,17 +17,18 @@ public:
     BattleFilterDialog();
     virtual ~BattleFilterDialog();
 
-    void show(std::string const & game, int players);
+    void show(std::string const & text, int players, bool installed); // text see BattleFilter
 
     // signals
     //
-    typedef boost::signals2::signal<void (std::string const & game, int players)> FilterSetSignal;
+    typedef boost::signals2::signal<void (std::string const & text, int players, bool installed)> FilterSetSignal;
     boost::signals2::connection connectFilterSet(FilterSetSignal::slot_type subscriber)
     { return filterSetSignal_.connect(subscriber); }
 
 private:
-    Fl_Input * game_;
+    Fl_Input * text_;
     Fl_Int_Input * players_;
+    Fl_Check_Button * installed_;
     Fl_Box * box_;
     FilterSetSignal filterSetSignal_;
 
@@ -58,17 +58,17 @@ BattleInfo::~BattleInfo()
 
 void BattleInfo::setMapImage(Battle const & battle)
 {
-    Fl_Image * image = cache_.getMapImage(battle.mapName());
+    Fl_Shared_Image * image = cache_.getMapImage(battle.mapName());
     if (image)
     {
         mapImageBox_->label(0);
-        mapImageBox_->image(image);
+        mapImageBox_->setImage(image);
         mapImageBox_->activate();
         currentMapImage_ = battle.mapName();
     }
     else if (!model_.getUnitSyncPath().empty())
     {
-        mapImageBox_->image(0);
+        mapImageBox_->setImage(0);
         std::string const msg = "click to\ndownload map\n" + battle.mapName();
         mapImageBox_->copy_label(msg.c_str());
         mapImageBox_->activate();
@@ -77,7 +77,7 @@ void BattleInfo::setMapImage(Battle const & battle)
     else
     {
         // disable map download since we don't have unitsync yet
-        mapImageBox_->image(0);
+        mapImageBox_->setImage(0);
         mapImageBox_->label("");
         mapImageBox_->deactivate();
         currentMapImage_.clear();
@@ -119,11 +119,14 @@ void BattleInfo::handleOnMapImage()
                     }
                     else
                     {
-                        Fl_Image * image = cache_.getMapImage(mapName);
+                        Fl_Shared_Image * image = cache_.getMapImage(mapName);
                         if (image && image != mapImageBox_->image())
                         {
-                            mapImageBox_->image(image);
-                            mapImageBox_->redraw();
+                            mapImageBox_->setImage(image);
+                        }
+                        else if (image)
+                        {
+                            image->release();
                         }
                     }
                 }
@@ -132,39 +135,14 @@ void BattleInfo::handleOnMapImage()
             break;
 
         case FL_MOUSEWHEEL:
-            Fl_Image * imageCurrent = mapImageBox_->image();
-            if (imageCurrent != 0)
+            if (mapImageBox_->image() != 0)
             {
-                Fl_Image * imageHeight = cache_.getHeightImage(mapName);
-                Fl_Image * imageMap = cache_.getMapImage(mapName);
-                Fl_Image * imageMetal = cache_.getMetalImage(mapName);
-
-                if (Fl::event_dy() < 0) // wheel up
-                {
-                    if (imageCurrent == imageMap)
-                    {
-                        mapImageBox_->image(imageHeight);
-                        mapImageBox_->redraw();
-                    }
-                    else if (imageCurrent == imageMetal)
-                    {
-                        mapImageBox_->image(imageMap);
-                        mapImageBox_->redraw();
-                    }
-                }
-                else if (Fl::event_dy() > 0) // wheel down
-                {
-                    if (imageCurrent == imageMap)
-                    {
-                        mapImageBox_->image(imageMetal);
-                        mapImageBox_->redraw();
-                    }
-                    else if (imageCurrent == imageHeight)
-                    {
-                        mapImageBox_->image(imageMap);
-                        mapImageBox_->redraw();
-                    }
-                }
+                // wheel up shows height map, wheel down shows metal map
+                Fl_Shared_Image * const images[] = {
+                    cache_.getHeightImage(mapName),
+                    cache_.getMapImage(mapName),
+                    cache_.getMetalImage(mapName) };
+                mapImageBox_->scrollImage(Fl::event_dy(), images, 3);
             }
             break;
     }
@@ -181,7 +159,7 @@ void BattleInfo::battle(Battle const & battle)
 void BattleInfo::reset()
 {
     battleId_ = -1;
-    mapImageBox_->image(0);
+    mapImageBox_->setImage(0);
     mapImageBox_->label(0);
     mapImageBox_->deactivate();
     currentMapImage_.clear();
@@ -199,7 +177,16 @@ void BattleInfo::setHeaderText(Battle const & battle)
 {
     std::ostringstream oss;
     oss << battle.title() << " / " << battle.founder() << " / " << battle.engineVersionLong() << "\n"
-        << battle.mapName() << "\n"
+        << battle.mapName();
+
+    // only cached info, no unitsync calls for map info here
+    MapInfo const * mapInfo = cache_.findMapInfo(battle.mapName());
+    if (mapInfo && mapInfo->hasMetalSpots_)
+    {
+        oss << " (" << mapInfo->metalSpots_.size() << " metal spots)";
+    }
+
+    oss << "\n"
         << battle.modName() << "\n"
         << "Users:";
 
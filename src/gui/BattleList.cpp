@@ -6,6 +6,7 @@
 #include "BattleFilterDialog.h"
 #include "PopupMenu.h"
 #include "Prefs.h"
+#include "Cache.h"
 #include "log/Log.h"
 
 #include "model/Model.h"
@@ -23,15 +24,25 @@
 
 static char const * PrefBattleFilterGame = "BattleFilterGame";
 static char const * PrefBattleFilterPlayers = "BattleFilterPlayers";
+static char const * PrefBattleFilterInstalled = "BattleFilterInstalled";
 
 
-BattleList::BattleList(int x, int y, int w, int h, Model & model, Cache & cache): // TODO cache is only needed by BattleInfo
+BattleList::BattleList(int x, int y, int w, int h, Model & model, Cache & cache):
     Fl_Group(x, y, w, h),
-    model_(model)
+    model_(model),
+    cache_(cache),
+    filter_(boost::bind(&Model::hasMap, &model, _1, _2), boost::bind(&Model::hasGame, &model, _1, _2))
 {
     int const h1 = h-128;
     battleList_ = new StringTable(x, y, w, h1, "BattleList",
-            { {"status",4}, {"title / host",15}, {"engine",4}, {"game",10}, {"map",15}, {"players",4} }, -5 /* sort on players by default */);
+            { {"status",4},
+              {"title / host",15, StringTableColumnDef::SK_NATURAL},
+              {"engine",4, StringTableColumnDef::SK_NATURAL},
+              {"game",10, StringTableColumnDef::SK_NATURAL},
+              {"map",15, StringTableColumnDef::SK_NATURAL},
+              {"players",4, StringTableColumnDef::SK_INTEGER},
+              {"local",6} }, -5 /* sort on players by default */);
+    battleList_->setSource(this);
 
     battleInfo_ = new BattleInfo(x, y+h1, w, h-h1, model_, cache);
 
@@ -54,20 +65,24 @@ BattleList::BattleList(int x, int y, int w, int h, Model & model, Cache & cache)
     battleList_->connectRowClicked( boost::bind(&BattleList::battleListRowClicked, this, _1, _2) );
     battleList_->connectRowDoubleClicked( boost::bind(&BattleList::battleListRowDoubleClicked, this, _1, _2) );
 
-    battleFilterDialog_->connectFilterSet( boost::bind(&BattleList::setFilter, this, _1, _2) );
+    battleFilterDialog_->connectFilterSet( boost::bind(&BattleList::setFilter, this, _1, _2, _3) );
 
     // read prefs
-    char str[65];
-    prefs().get(PrefBattleFilterGame, str, "", 64);
-    filterGame_ = str;
+    char str[257];
+    prefs().get(PrefBattleFilterGame, str, "", 256);
+    filterText_ = str;
     prefs().get(PrefBattleFilterPlayers, filterPlayers_, 0);
-
+    int installed;
+    prefs().get(PrefBattleFilterInstalled, installed, 0);
+    filterInstalled_ = (installed != 0);
+    filter_.set(filterText_, filterPlayers_, filterInstalled_);
 }
 
 BattleList::~BattleList()
 {
-    prefs().set(PrefBattleFilterGame, filterGame_.c_str());
+    prefs().set(PrefBattleFilterGame, filterText_.c_str());
     prefs().set(PrefBattleFilterPlayers, filterPlayers_);
+    prefs().set(PrefBattleFilterInstalled, filterInstalled_ ? 1 : 0);
 }
 
 void BattleList::loginResult(bool success, std::string const & info)
@@ -76,12 +91,12 @@ void BattleList::loginResult(bool success, std::string const & info)
     {
         std::vector<Battle const *> battles = model_.getBattles();
 
+        StringTable::Update update(*battleList_);
         for (auto b : battles)
         {
             assert(b);
             battleOpened(*b);
         }
-        battleList_->sort();
     }
 }
 
@@ -89,7 +104,7 @@ void BattleList::battleOpened(const Battle & battle)
 {
     if (passesFilter(battle))
     {
-        battleList_->addRow(makeRow(battle));
+        battleList_->addRow(boost::lexical_cast<std::string>(battle.id()));
     }
 }
 
@@ -99,15 +114,14 @@ void BattleList::battleChanged(const Battle & battle)
 {
     if (passesFilter(battle))
     {
-        StringTableRow row = makeRow(battle);
-        try
+        std::string const id = boost::lexical_cast<std::string>(battle.id());
+        if (battleList_->rowExist(id))
         {
-            battleList_->updateRow(row);
+            battleList_->updateRow(id);
         }
-        catch (std::runtime_error & e)
+        else
         {
-            // battle was not in list, add it
-            battleList_->addRow(row);
+            battleList_->addRow(id);
         }
     }
     else
@@ -145,6 +159,14 @@ void BattleList::userJoinedLeftBattle(User const & user, const Battle & battle)
 
 void BattleList::refresh()
 {
+    // installed content changed, rows are updated to keep selection
+    {
+        StringTable::Update update(*battleList_);
+        for (Battle const * b : model_.getBattles())
+        {
+            battleChanged(*b);
+        }
+    }
     battleInfo_->refresh();
 }
 
@@ -159,6 +181,8 @@ void BattleList::battleListRowChanged(int rowIndex)
         {
             Battle const & battle = model_.getBattle(battleId);
             battleInfo_->battle(battle);
+            // AIs and sides are then available without mounting the game when joining
+            cache_.preloadGameInfo(battle.modName());
         } catch (std::exception const & e)
         {
             LOG(WARNING) << "exception in battleListRowChanged:" << e.what();
@@ -231,18 +255,51 @@ std::string BattleList::statusString(Battle const & battle)
     return oss.str();
 }
 
-StringTableRow BattleList::makeRow(Battle const & battle)
+std::vector<std::string> BattleList::cells(std::string const & battleId)
+{
+    Battle const & battle = model_.getBattle(boost::lexical_cast<int>(battleId));
+    std::vector<std::string> cells;
+    for (int col = 0; col < battleList_->cols(); ++col)
+    {
+        cells.push_back(cell(battle, col));
+    }
+    return cells;
+}
+
+std::string BattleList::cell(std::string const & battleId, int col)
+{
+    return cell(model_.getBattle(boost::lexical_cast<int>(battleId)), col);
+}
+
+std::string BattleList::cell(Battle const & battle, int col)
+{
+    switch (col)
+    {
+    case 0: return statusString(battle);
+    case 1: return battle.title() + " / " + battle.founder();
+    case 2: return battle.engineVersionLong();
+    case 3: return battle.modName();
+    case 4: return battle.mapName();
+    case 5:
+    {
+        boost::format players("%2d %2d/%2d"); // players (non-specs/maxplayers)
+        players % battle.playerCount() % (battle.playerCount()-battle.spectators()) % battle.maxPlayers();
+        return players.str();
+    }
+    case 6: return localString(battle);
+    }
+    return std::string();
+}
+
+std::string BattleList::localString(Battle const & battle)
 {
-    boost::format players("%2d %2d/%2d"); // players (non-specs/maxplayers)
-    players % battle.playerCount() % (battle.playerCount()-battle.spectators()) % battle.maxPlayers();
-
-    return StringTableRow( boost::lexical_cast<std::string>(battle.id()),
-            { statusString(battle),
-              battle.title() + " / " + battle.founder(),
-              battle.engineVersionLong(),
-              battle.modName(),
-              battle.mapName(),
-              players.str() } );
+    bool const game = model_.hasGame(battle.modName(), battle.modHash());
+    bool const map = model_.hasMap(battle.mapName(), battle.mapHash());
+
+    if (game && map) return "yes";
+    if (game) return "no map";
+    if (map) return "no game";
+    return "no";
 }
 
 void BattleList::connected(bool connected)
@@ -254,18 +311,22 @@ void BattleList::connected(bool connected)
     }
 }
 
-void BattleList::setFilter(std::string const & game, int players)
+void BattleList::setFilter(std::string const & text, int players, bool installed)
 {
-    filterGame_ = game;
+    filterText_ = text;
     filterPlayers_ = players;
+    filterInstalled_ = installed;
+    filter_.set(filterText_, filterPlayers_, filterInstalled_);
 
+    // selected battle stays selected if it passes the new filter
+    StringTable::Update update(*battleList_);
     battleList_->clear();
 
     for (Battle const * b : model_.getBattles())
     {
         if (passesFilter(*b))
         {
-            battleList_->addRow(makeRow(*b));
+            battleList_->addRow(boost::lexical_cast<std::string>(b->id()));
         }
 
     }
@@ -273,38 +334,10 @@ void BattleList::setFilter(std::string const & game, int players)
 
 bool BattleList::passesFilter(Battle const & battle)
 {
-    if (battle.playerCount() < filterPlayers_) return false;
-
-    if (!filterGame_.empty())
-    {
-        std::vector<std::string> games;
-        boost::algorithm::split(games, filterGame_, boost::is_any_of(","));
-
-        int matches = 0;
-        for (auto& game : games)
-        {
-            boost::trim(game);
-
-            if (game.empty())
-            {
-                // ignore empty game filters
-                matches += 1;
-            }
-            else if ( !boost::algorithm::ifind_first(battle.modName(), game).empty() )
-            {
-                matches += 1;
-            }
-        }
-        if (matches == 0)
-        {
-            return false;
-        }
-    }
-
-    return true;
+    return filter_.match(battle);
 }
 
 void BattleList::showFilterDialog()
 {
-    battleFilterDialog_->show(filterGame_, filterPlayers_);
+    battleFilterDialog_->show(filterText_, filterPlayers_, filterInstalled_);
 }
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "StringTable.h"
+#include "model/BattleFilter.h"
 
 #include <FL/Fl_Group.H>
 
@@ -15,7 +16,8 @@ class BattleInfo;
 class Cache;
 class BattleFilterDialog;
 
-class BattleList: public Fl_Group
+// rows are formatted from the model when drawn, the list only keeps battle ids
+class BattleList: public Fl_Group, public StringTableSource
 {
 public:
     BattleList(int x, int y, int w, int h, Model & model, Cache & cache);
@@ -28,10 +30,13 @@ public:
 
 private:
     Model & model_;
+    Cache & cache_;
     StringTable * battleList_;
     BattleInfo * battleInfo_;
-    std::string filterGame_;
+    std::string filterText_; // see BattleFilter
     int filterPlayers_;
+    bool filterInstalled_; // only battles with game and map installed
+    BattleFilter filter_; // compiled from above
     BattleFilterDialog * battleFilterDialog_;
 
     // model signal handlers
@@ -47,13 +52,17 @@ private:
     void battleListRowClicked(int rowIndex, int button);
     void battleListRowDoubleClicked(int rowIndex, int button);
 
-    StringTableRow makeRow(Battle const & battle);
+    // StringTableSource
+    std::vector<std::string> cells(std::string const & battleId);
+    std::string cell(std::string const & battleId, int col);
+    std::string cell(Battle const & battle, int col);
     std::string statusString(Battle const & battle);
+    std::string localString(Battle const & battle); // game and map installed or missing
 
     void joinBattle(Battle const & battle);
 
     bool passesFilter(Battle const & battle);
-    void setFilter(std::string const & game, int players);
+    void setFilter(std::string const & text, int players, bool installed);
 
 };
 
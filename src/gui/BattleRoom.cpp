@@ -27,6 +27,7 @@
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 #include <sstream>
 #include <cassert>
 
@@ -42,7 +43,8 @@ BattleRoom::BattleRoom(int x, int y, int w, int h, Model & model, Cache & cache,
     iTabs_(iTabs),
     springDialog_(springDialog),
     battleId_(-1),
-    lastRunning_(false)
+    lastRunning_(false),
+    settingsChecksum_(0)
 {
     // limit split drag
     resizable( new Fl_Box(this->x(), this->y()+100, this->w(), this->h()-(100+100)) );
@@ -125,7 +127,11 @@ BattleRoom::BattleRoom(int x, int y, int w, int h, Model & model, Cache & cache,
     int const playerH = topH - headerH;
 
     playerList_ = new StringTable(x, y, w - rightW, playerH, "PlayerList",
-            { {"status",4}, {"sync",3}, {"name",10}, {"side",4}, {"ally",3}, {"team",4}, {"rank",3}, {"color",3}, {"country",4} }, 4 /* sort on ally by default */);
+            { {"status",4}, {"sync",3}, {"name",10}, {"side",4},
+              {"ally",3, StringTableColumnDef::SK_NATURAL},
+              {"team",4, StringTableColumnDef::SK_NATURAL},
+              {"rank",3, StringTableColumnDef::SK_INTEGER},
+              {"color",3}, {"country",4} }, 4 /* sort on ally by default */);
 
     top_->resizable(playerList_);
     top_->end();
@@ -139,10 +145,11 @@ BattleRoom::BattleRoom(int x, int y, int w, int h, Model & model, Cache & cache,
     end();
     top_->deactivate();
 
-    addBotDialog_ = new AddBotDialog(model);
+    addBotDialog_ = new AddBotDialog(model, cache);
 
     // model signals
     model_.connectBattleJoined( boost::bind(&BattleRoom::joined, this, _1) );
+    cache_.connectGameInfoLoaded( boost::bind(&BattleRoom::gameInfoLoaded, this, _1) );
     model_.connectBattleChanged( boost::bind(&BattleRoom::battleChanged, this, _1) );
     model_.connectBattleClosed( boost::bind(&BattleRoom::battleClosed, this, _1) );
     model_.connectUserJoinedBattle( boost::bind(&BattleRoom::userJoinedBattle, this, _1, _2) );
@@ -176,13 +183,18 @@ void BattleRoom::initTiles()
     position(0, battleChat_->y(), 0, y);
 }
 
+int BattleRoom::mapImageSize() const
+{
+    return std::min(mapImageBox_->w(), mapImageBox_->h());
+}
+
 void BattleRoom::setMapImage(Battle const & battle)
 {
-    Fl_Image * image = cache_.getMapImage(battle.mapName());
+    Fl_Shared_Image * image = cache_.getMapImage(battle.mapName(), mapImageSize());
     if (image)
     {
         mapImageBox_->label(0);
-        mapImageBox_->image(image);
+        mapImageBox_->setImage(image);
         mapImageBox_->activate();
 
         MapInfo const & mapInfo = cache_.getMapInfo(battle.mapName());
@@ -190,13 +202,14 @@ void BattleRoom::setMapImage(Battle const & battle)
         oss << "Size: " << mapInfo.width_/512 << "x" << mapInfo.height_/512 << "\n"
             << "Wind: " << mapInfo.windMin_ << "-" << mapInfo.windMax_ << "\n"
             << "Tidal: " << mapInfo.tidalStrength_ << "\n"
-            << "Gravity: " << mapInfo.gravity_ << "\n";
+            << "Gravity: " << mapInfo.gravity_ << "\n"
+            << "Metal spots: " << mapInfo.metalSpots_.size() << "\n";
 
         mapInfo_->value(oss.str().c_str());
     }
     else if (!model_.getUnitSyncPath().empty())
     {
-        mapImageBox_->image(0);
+        mapImageBox_->setImage(0);
         std::string const msg = "click to\ndownload map\n" + battle.mapName();
         mapImageBox_->copy_label(msg.c_str());
         mapImageBox_->activate();
@@ -206,7 +219,7 @@ void BattleRoom::setMapImage(Battle const & battle)
     else
     {
         // disable map download since we don't have unitsync yet
-        mapImageBox_->image(0);
+        mapImageBox_->setImage(0);
         mapImageBox_->label("");
         mapImageBox_->deactivate();
 
@@ -222,7 +235,6 @@ void BattleRoom::updateDownloadButtons(Battle const & battle)
     if ( !model_.gameExist(battle.modName()) && !model_.getUnitSyncPath().empty())
     {
         showDownloadGameButton(Model::DT_GAME);
-        sideNames_.clear();
     }
     else if (springProfile_ != battle.engineVersion())
     {
@@ -231,7 +243,24 @@ void BattleRoom::updateDownloadButtons(Battle const & battle)
     else
     {
         hideDownloadGameButton();
-        sideNames_ = model_.getModSideNames(battle.modName());
+    }
+
+    // game info is loaded in idle time if not cached, gameInfoLoaded updates sides and settings
+    GameInfo const * gameInfo = cache_.findGameInfo(battle.modName());
+    if (gameInfo)
+    {
+        sideNames_ = gameInfo->sideNames_;
+    }
+    else
+    {
+        sideNames_.clear();
+        cache_.preloadGameInfo(battle.modName());
+    }
+    unsigned int const checksum = gameInfo ? gameInfo->checksum_ : 0;
+    if (checksum != settingsChecksum_)
+    {
+        settingsChecksum_ = checksum;
+        settings_->game(gameInfo);
     }
 
     if (currentMapImage_ != battle.mapName())
@@ -405,7 +434,7 @@ void BattleRoom::close()
 
     battleId_ = -1;
 
-    mapImageBox_->image(0);
+    mapImageBox_->setImage(0);
     mapImageBox_->label(0);
     currentMapImage_.clear();
     mapInfo_->value(0);
@@ -418,7 +447,8 @@ void BattleRoom::close()
 
     mapImageBox_->removeAllStartRects();
 
-    settings_->clear();
+    settings_->reset();
+    settingsChecksum_ = 0;
 
     top_->deactivate();
 }
@@ -631,6 +661,18 @@ void BattleRoom::setHeaderText(Battle const & battle)
     headerText_->value(oss.str().c_str());
 }
 
+void BattleRoom::gameInfoLoaded(std::string const & gameName)
+{
+    if (battleId_ != -1)
+    {
+        Battle const & battle = model_.getBattle(battleId_);
+        if (battle.modName() == gameName)
+        {
+            updateDownloadButtons(battle);
+        }
+    }
+}
+
 void BattleRoom::refresh()
 {
     if (battleId_ != -1)
@@ -850,11 +892,14 @@ void BattleRoom::handleOnMapImage()
                     }
                     else
                     {
-                        Fl_Image * image = cache_.getMapImage(mapName);
+                        Fl_Shared_Image * image = cache_.getMapImage(mapName, mapImageSize());
                         if (image && image != mapImageBox_->image())
                         {
-                            mapImageBox_->image(image);
-                            mapImageBox_->redraw();
+                            mapImageBox_->setImage(image);
+                        }
+                        else if (image)
+                        {
+                            image->release();
                         }
                     }
                 }
@@ -863,39 +908,14 @@ void BattleRoom::handleOnMapImage()
             break;
 
         case FL_MOUSEWHEEL:
-            Fl_Image * imageCurrent = mapImageBox_->image();
-            if (imageCurrent != 0)
+            if (mapImageBox_->image() != 0)
             {
-                Fl_Image * imageHeight = cache_.getHeightImage(mapName);
-                Fl_Image * imageMap = cache_.getMapImage(mapName);
-                Fl_Image * imageMetal = cache_.getMetalImage(mapName);
-
-                if (Fl::event_dy() < 0) // wheel up
-                {
-                    if (imageCurrent == imageMap)
-                    {
-                        mapImageBox_->image(imageHeight);
-                        mapImageBox_->redraw();
-                    }
-                    else if (imageCurrent == imageMetal)
-                    {
-                        mapImageBox_->image(imageMap);
-                        mapImageBox_->redraw();
-                    }
-                }
-                else if (Fl::event_dy() > 0) // wheel down
-                {
-                    if (imageCurrent == imageMap)
-                    {
-                        mapImageBox_->image(imageMetal);
-                        mapImageBox_->redraw();
-                    }
-                    else if (imageCurrent == imageHeight)
-                    {
-                        mapImageBox_->image(imageMap);
-                        mapImageBox_->redraw();
-                    }
-                }
+                // wheel up shows height map, wheel down shows metal map
+                Fl_Shared_Image * const images[] = {
+                    cache_.getHeightImage(mapName),
+                    cache_.getMapImage(mapName, mapImageSize()),
+                    cache_.getMetalImage(mapName) };
+                mapImageBox_->scrollImage(Fl::event_dy(), images, 3);
             }
             break;
     }
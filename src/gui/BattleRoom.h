@@ -86,6 +86,7 @@ private:
     GameSettings * settings_;
     std::string currentMapImage_; // optimization, indicates what map image is currently shown to avoid setting the same image
     std::vector<std::string> sideNames_;
+    unsigned int settingsChecksum_; // of game options shown in settings_, 0 if none
 
     typedef std::map<int,int> Balance;
     Balance balance_; // number of non-spec players in unique ally teams
@@ -108,6 +109,7 @@ private:
     void close(); // call when user (me) left the battle
 
     void setMapImage(Battle const & battle);
+    int mapImageSize() const; // largest map image that fits in mapImageBox_
     void setHeaderText(Battle const & battle);
     std::string statusString(User const & user);
     std::string syncString(User const & user);
@@ -117,7 +119,10 @@ private:
     void handleOnDownloadGame();
     void hideDownloadGameButton();
     void showDownloadGameButton(Model::DownloadType downloadType);
-    void updateDownloadButtons(Battle const & battle);
+    void updateDownloadButtons(Battle const & battle); // also updates sides and game settings
+
+    // cache signal handler
+    void gameInfoLoaded(std::string const & gameName);
 
     void playerClicked(int rowIndex, int button);
     void playerDoubleClicked(int rowIndex, int button);
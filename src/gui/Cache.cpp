@@ -1,26 +1,154 @@
 // This file is part of flobby (GPL v2 or later), see the LICENSE file
 
 #include "Cache.h"
+#include "MyImage.h"
 
 #include "log/Log.h"
 #include "model/Model.h"
 #include "FlobbyDirs.h"
+#include "Prefs.h"
+#include "image/PixelKernels.h"
+#include "image/Resample.h"
+#include "image/MetalSpots.h"
+#include "model/PackFile.h"
 
-#include <Magick++.h>
 #include <FL/Fl_Shared_Image.H>
+#include <FL/Fl.H>
 
 #include <sstream> // ostringstream
 #include <fstream>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include <vector>
 #include <cassert>
+#include <cstdio> // rename
+
+namespace
+{
+
+// shared image of an image stored in the pack file, pixels are not copied if pixels point into the pack mapping
+class PackedImage: public Fl_Shared_Image
+{
+public:
+    PackedImage(std::string const & name, uchar const * pixels, int w, int h, int d, bool copy):
+        Fl_Shared_Image(name.c_str(), createImage(pixels, w, h, d, copy))
+    {
+        alloc_image_ = 1;
+        add();
+    }
+
+private:
+    static Fl_RGB_Image * createImage(uchar const * pixels, int w, int h, int d, bool copy)
+    {
+        if (copy)
+        {
+            std::size_t const size = static_cast<std::size_t>(w)*h*d;
+            uchar * array = new uchar[size];
+            std::memcpy(array, pixels, size);
+            Fl_RGB_Image * image = new Fl_RGB_Image(array, w, h, d);
+            image->alloc_array = 1;
+            return image;
+        }
+        return new Fl_RGB_Image(pixels, w, h, d);
+    }
+};
+
+// returns the mapInfoKey() part of an image key if it is one of mapKeys, otherwise an empty string
+std::string imageMapKey(std::string const & imageKey, std::unordered_set<std::string> const & mapKeys)
+{
+    // map names can contain '_' so try each possible split, type is the short part at the end
+    for (std::size_t pos = imageKey.rfind('_'); pos != std::string::npos && pos > 0; pos = imageKey.rfind('_', pos - 1))
+    {
+        std::string const mapKey = imageKey.substr(0, pos);
+        if (mapKeys.count(mapKey) > 0)
+        {
+            return mapKey;
+        }
+    }
+    return std::string();
+}
+
+// game infos are preloaded when the user has not selected another battle for a while, a few at most
+double const preloadDelay = 1.0; // seconds
+std::size_t const preloadQueueMax = 4;
+
+} // namespace
+
+static char const * PrefMapImageCacheMB = "MapImageCacheMB";
+static char const * PrefMapCacheDiskMB = "MapCacheDiskMB";
 
 Cache::Cache(Model & model):
-    model_(model)
+    model_(model),
+    gcRunning_(false)
 {
+    int megaBytes;
+    prefs().get(PrefMapImageCacheMB, megaBytes, 32);
+    imageBudget_ = static_cast<std::size_t>(std::max(megaBytes, 1))*1024*1024;
+
+    prefs().get(PrefMapCacheDiskMB, megaBytes, 1024);
+    diskBudget_ = static_cast<std::size_t>(std::max(megaBytes, 1))*1024*1024;
+
+    try
+    {
+        imagePack_.reset(new PackFile(mapDir() + "images.pack")); // compacted by the gc thread
+    }
+    catch (std::exception const & e)
+    {
+        LOG(WARNING) << "map image pack not available, images will not be cached: " << e.what();
+    }
+
+    loadMapInfos();
+    loadAccessTimes();
+    loadGameInfos();
 }
 
 Cache::~Cache()
 {
+    Fl::remove_timeout(checkGc, this);
+    Fl::remove_timeout(preloadNext, this);
+    if (gcThread_.joinable())
+    {
+        gcThread_.join();
+    }
+    saveAccessTimes();
+
+    LOG(INFO) << "image cache: hits " << stats_.hits_
+              << ", misses " << stats_.misses_
+              << ", evictions " << stats_.evictions_
+              << ", images " << stats_.images_
+              << ", bytes " << stats_.bytes_;
+
+    for (auto& pair : images_)
+    {
+        pair.second.image_->release();
+    }
+}
+
+void Cache::imageBudget(std::size_t megaBytes)
+{
+    megaBytes = std::max<std::size_t>(megaBytes, 1);
+    prefs().set(PrefMapImageCacheMB, static_cast<int>(megaBytes));
+    imageBudget_ = megaBytes*1024*1024;
+    trimImages();
+}
+
+std::size_t Cache::imageBudget() const
+{
+    return imageBudget_/(1024*1024);
+}
+
+void Cache::diskBudget(std::size_t megaBytes)
+{
+    megaBytes = std::max<std::size_t>(megaBytes, 1);
+    prefs().set(PrefMapCacheDiskMB, static_cast<int>(megaBytes));
+    diskBudget_ = megaBytes*1024*1024;
+}
+
+std::size_t Cache::diskBudget() const
+{
+    return diskBudget_/(1024*1024);
 }
 
 std::string Cache::mapDir()
@@ -33,6 +161,16 @@ std::string Cache::mapDir()
     return basePath;
 }
 
+std::string Cache::gameDir()
+{
+    std::string basePath = cacheDir() + "game/";
+    if (!boost::filesystem::is_directory(basePath.c_str()))
+    {
+        boost::filesystem::create_directories(basePath.c_str());
+    }
+    return basePath;
+}
+
 std::string Cache::mapPath(std::string const& mapName, std::string const& suffix)
 {
     std::string path;
@@ -53,19 +191,21 @@ std::string Cache::pathMapInfo(std::string const& mapName)
     return mapPath(mapName, "info.bin");
 }
 
-std::string Cache::pathMapImage(std::string const& mapName)
+std::string Cache::imageKey(std::string const& mapName, std::string const& type)
 {
-    return mapPath(mapName, "minimap_128.png");
-}
+    std::string key;
 
-std::string Cache::pathMetalImage(std::string const& mapName)
-{
-    return mapPath(mapName, "metal_128.png");
-}
+    unsigned int const chksum = model_.getMapChecksum(mapName);
+    if (chksum != 0)
+    {
+        std::ostringstream oss;
+        oss << mapName << "_" << chksum;
+        touch(oss.str());
+        oss << "_" << type;
+        key = oss.str();
+    }
 
-std::string Cache::pathHeightImage(std::string const& mapName)
-{
-    return mapPath(mapName, "height_128.png");
+    return key;
 }
 
 std::string Cache::mapInfoKey(std::string const& mapName)
@@ -81,83 +221,729 @@ std::string Cache::mapInfoKey(std::string const& mapName)
     std::ostringstream oss;
     oss << mapName << "_" << chksum;
     key = oss.str();
+    touch(key);
     return key;
 }
 
-bool Cache::hasMapInfo(std::string const& mapName)
+std::string Cache::gameInfoKey(std::string const& gameName)
 {
-    std::string const key = mapInfoKey(mapName);
-    auto it = mapInfos_.find(key);
-    if (it != mapInfos_.end())
+    unsigned int const chksum = model_.getGameChecksum(gameName);
+    if (chksum == 0)
     {
-        // loaded into memory
-        return true;
+        return std::string();
     }
+    std::ostringstream oss;
+    oss << gameName << "_" << chksum;
+    return oss.str();
+}
 
-    std::string const path = pathMapInfo(mapName);
+void Cache::touch(std::string const & mapKey)
+{
+    accessTimes_[mapKey] = std::time(0);
+}
 
-    return !path.empty() && boost::filesystem::exists(path);
+std::string Cache::pathAccessTimes()
+{
+    return mapDir() + "access.txt";
 }
 
-bool Cache::hasMapImage(std::string const & mapName)
+void Cache::loadAccessTimes()
 {
-    std::string const path = pathMapImage(mapName);
+    // lines with "<time> <mapInfoKey>"
+    std::ifstream ifs(pathAccessTimes());
+    std::time_t t;
+    std::string key;
+    while (ifs >> t && ifs.get() == ' ' && std::getline(ifs, key))
+    {
+        accessTimes_[key] = t;
+    }
+}
 
-    return !path.empty() && (Fl_Shared_Image::find(path.c_str()) || boost::filesystem::exists(path));
+void Cache::saveAccessTimes()
+{
+    std::string const path = pathAccessTimes();
+    std::string const tmpPath = path + ".tmp";
+    {
+        std::ofstream ofs(tmpPath);
+        for (auto const & pair : accessTimes_)
+        {
+            ofs << pair.second << " " << pair.first << "\n";
+        }
+        if (!ofs.good())
+        {
+            LOG(WARNING) << "failed to write " << tmpPath;
+            return;
+        }
+    }
+    std::rename(tmpPath.c_str(), path.c_str());
 }
 
-bool Cache::hasMetalImage(std::string const & mapName)
+void Cache::collectGarbage()
+{
+    if (gcRunning_)
+    {
+        LOG(DEBUG) << "map cache gc already running";
+        return;
+    }
+
+    std::vector<std::string> const maps = model_.getMaps();
+    if (maps.empty())
+    {
+        // unitsync not loaded, no way to tell which entries are stale
+        return;
+    }
+
+    GcJob job;
+    for (auto const & map : maps)
+    {
+        unsigned int const chksum = model_.getMapChecksum(map);
+        if (chksum != 0)
+        {
+            std::ostringstream oss;
+            oss << map << "_" << chksum;
+            job.liveMaps_.insert(oss.str());
+        }
+    }
+
+    for (auto it = accessTimes_.begin(); it != accessTimes_.end(); )
+    {
+        if (job.liveMaps_.count(it->first) == 0)
+        {
+            it = accessTimes_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    saveAccessTimes();
+
+    // info files of older versions are kept until migrated
+    job.keepFiles_.insert("access.txt");
+    for (auto const & mapKey : job.liveMaps_)
+    {
+        if (mapInfos_.count(mapKey) == 0)
+        {
+            job.keepFiles_.insert(mapKey + "_info.bin");
+        }
+    }
+
+    if (infoPack_) job.infoPath_ = infoPack_->path();
+    if (imagePack_) job.imagePath_ = imagePack_->path();
+    if (gamePack_) job.gamePath_ = gamePack_->path();
+    job.dir_ = mapDir();
+    job.contentIndex_ = model_.contentIndex();
+    job.accessTimes_ = accessTimes_;
+    job.diskBudget_ = diskBudget_;
+
+    if (gcThread_.joinable())
+    {
+        gcThread_.join();
+    }
+    gcRemovedMaps_.clear();
+    gcRemovedGames_.clear();
+    gcRunning_ = true;
+    gcThread_ = std::thread([this, job]()
+    {
+        removeStale(job, gcRemovedMaps_, gcRemovedGames_);
+
+        std::vector<std::string> packPaths;
+        for (auto const & path : { job.infoPath_, job.imagePath_, job.gamePath_ })
+        {
+            if (!path.empty()) packPaths.push_back(path);
+        }
+        cleanFiles(packPaths, job.dir_, job.keepFiles_);
+        gcRunning_ = false;
+    });
+    Fl::remove_timeout(checkGc, this);
+    Fl::add_timeout(1.0, checkGc, this);
+}
+
+void Cache::removeStale(GcJob const & job, std::vector<std::string> & removedMaps, std::vector<std::string> & removedGames)
+{
+    // own pack instances, the ones used by the ui thread pick up the removals in reload()
+    std::size_t removedImages = 0;
+    try
+    {
+        std::size_t infoSize = 0;
+        if (!job.infoPath_.empty())
+        {
+            PackFile infoPack(job.infoPath_);
+            for (auto const & key : infoPack.keys())
+            {
+                if (job.liveMaps_.count(key) == 0)
+                {
+                    infoPack.remove(key);
+                    removedMaps.push_back(key);
+                }
+            }
+            infoSize = infoPack.fileSize() - infoPack.garbageSize();
+        }
+
+        if (!job.imagePath_.empty())
+        {
+            PackFile imagePack(job.imagePath_);
+            for (auto const & key : imagePack.keys())
+            {
+                if (imageMapKey(key, job.liveMaps_).empty())
+                {
+                    imagePack.remove(key);
+                    ++removedImages;
+                }
+            }
+            evictMapImages(job, imagePack, infoSize);
+        }
+
+        if (!job.gamePath_.empty())
+        {
+            PackFile gamePack(job.gamePath_);
+            for (auto const & key : gamePack.keys())
+            {
+                // key is "<gamename>_<chksum>", game names can contain '_', games not looked up this session are kept
+                std::size_t const pos = key.rfind('_');
+                std::string const gameName = key.substr(0, pos);
+                if (pos != std::string::npos && !job.contentIndex_.knowsGame(gameName))
+                {
+                    continue;
+                }
+                std::ostringstream oss;
+                oss << gameName << "_" << job.contentIndex_.gameChecksum(gameName);
+                if (pos == std::string::npos || oss.str() != key)
+                {
+                    gamePack.remove(key);
+                    removedGames.push_back(key);
+                }
+            }
+        }
+    }
+    catch (std::exception const & e)
+    {
+        LOG(WARNING) << "map cache gc failed: " << e.what();
+    }
+
+    LOG(INFO) << "map cache gc removed " << (removedMaps.size() + removedImages + removedGames.size())
+              << " entries of maps and games no longer available";
+}
+
+void Cache::evictMapImages(GcJob const & job, PackFile & imagePack, std::size_t infoSize)
+{
+    std::size_t total = infoSize;
+
+    // image bytes and keys per map
+    std::unordered_map<std::string, std::pair<std::size_t, std::vector<std::string> > > mapImages;
+    for (auto const & key : imagePack.keys())
+    {
+        std::size_t size = 0;
+        imagePack.get(key, size);
+        auto & entry = mapImages[imageMapKey(key, job.liveMaps_)];
+        entry.first += size;
+        entry.second.push_back(key);
+        total += size;
+    }
+
+    if (total <= job.diskBudget_)
+    {
+        return;
+    }
+
+    // least recently used first, maps never used since access times were added are evicted first
+    std::vector<std::pair<std::time_t, std::string> > maps;
+    for (auto const & pair : mapImages)
+    {
+        auto const it = job.accessTimes_.find(pair.first);
+        maps.push_back(std::make_pair(it == job.accessTimes_.end() ? 0 : it->second, pair.first));
+    }
+    std::sort(maps.begin(), maps.end());
+
+    std::size_t evicted = 0;
+    for (auto const & m : maps)
+    {
+        if (total <= job.diskBudget_)
+        {
+            break;
+        }
+        auto const & entry = mapImages[m.second];
+        for (auto const & key : entry.second)
+        {
+            imagePack.remove(key);
+        }
+        total -= entry.first;
+        ++evicted;
+    }
+    LOG(INFO) << "map cache over disk budget, removed images of " << evicted << " maps";
+}
+
+void Cache::cleanFiles(std::vector<std::string> const & packPaths, std::string const & dir, std::unordered_set<std::string> const & keepFiles)
+{
+    namespace fs = boost::filesystem;
+
+    std::size_t removed = 0;
+    try
+    {
+        for (fs::directory_iterator it(dir); it != fs::directory_iterator(); ++it)
+        {
+            std::string const name = it->path().filename().string();
+            // pack files and their temporary files are not touched
+            if (fs::is_regular_file(it->status()) && name.find(".pack") == std::string::npos && keepFiles.count(name) == 0)
+            {
+                boost::system::error_code ec;
+                if (fs::remove(it->path(), ec))
+                {
+                    ++removed;
+                }
+            }
+        }
+    }
+    catch (std::exception const & e)
+    {
+        LOG(WARNING) << "failed to clean " << dir << ": " << e.what();
+    }
+    if (removed > 0)
+    {
+        LOG(INFO) << "removed " << removed << " old map cache files";
+    }
+
+    for (auto const & path : packPaths)
+    {
+        try
+        {
+            // own instance, the pack files used by the ui thread pick up the new file in reload()
+            PackFile pack(path);
+            if (pack.garbageSize() > 0)
+            {
+                pack.compact();
+            }
+        }
+        catch (std::exception const & e)
+        {
+            LOG(WARNING) << "failed to compact " << path << ": " << e.what();
+        }
+    }
+}
+
+void Cache::checkGc(void * data)
+{
+    Cache * cache = static_cast<Cache*>(data);
+    if (cache->gcRunning_)
+    {
+        Fl::repeat_timeout(1.0, checkGc, data);
+        return;
+    }
+
+    if (cache->gcThread_.joinable())
+    {
+        cache->gcThread_.join();
+    }
+    for (auto const & key : cache->gcRemovedMaps_)
+    {
+        cache->mapInfos_.erase(key);
+    }
+    for (auto const & key : cache->gcRemovedGames_)
+    {
+        cache->gameInfos_.erase(key);
+    }
+    try
+    {
+        if (cache->infoPack_) cache->infoPack_->reload();
+        if (cache->imagePack_) cache->imagePack_->reload();
+        if (cache->gamePack_) cache->gamePack_->reload();
+    }
+    catch (std::exception const & e)
+    {
+        LOG(WARNING) << "failed to reload map cache: " << e.what();
+    }
+}
+
+void Cache::loadMapInfos()
+{
+    try
+    {
+        infoPack_.reset(new PackFile(mapDir() + "mapinfo.pack"));
+    }
+    catch (std::exception const & e)
+    {
+        LOG(WARNING) << "map info pack not available, map infos will not be cached: " << e.what();
+        return;
+    }
+
+    for (auto const & key : infoPack_->keys())
+    {
+        std::size_t size;
+        char const * data = reinterpret_cast<char const *>(infoPack_->get(key, size));
+        try
+        {
+            MapInfo mapInfo;
+            mapInfo.unserialize(data, size);
+            mapInfos_[key] = mapInfo;
+        }
+        catch (std::exception const & e)
+        {
+            LOG(WARNING) << "bad map info " << key << ": " << e.what();
+        }
+    }
+    LOG(DEBUG) << "loaded " << mapInfos_.size() << " map infos";
+}
+
+void Cache::storeMapInfo(std::string const & key, MapInfo const & mapInfo)
 {
-    std::string const path = pathMetalImage(mapName);
+    if (infoPack_)
+    {
+        std::string record;
+        mapInfo.serialize(record);
+        try
+        {
+            infoPack_->put(key, record.data(), record.size());
+        }
+        catch (std::exception const & e)
+        {
+            LOG(WARNING) << "failed to store map info " << key << ": " << e.what();
+        }
+    }
+}
 
-    return !path.empty() && (Fl_Shared_Image::find(path.c_str()) || boost::filesystem::exists(path));
+void Cache::loadGameInfos()
+{
+    try
+    {
+        gamePack_.reset(new PackFile(gameDir() + "gameinfo.pack"));
+    }
+    catch (std::exception const & e)
+    {
+        LOG(WARNING) << "game info pack not available, game infos will only be cached in memory: " << e.what();
+        return;
+    }
+
+    for (auto const & key : gamePack_->keys())
+    {
+        std::size_t size;
+        char const * data = reinterpret_cast<char const *>(gamePack_->get(key, size));
+        try
+        {
+            GameInfo gameInfo;
+            gameInfo.unserialize(data, size);
+            gameInfos_[key] = gameInfo;
+        }
+        catch (std::exception const & e)
+        {
+            LOG(WARNING) << "bad game info " << key << ": " << e.what();
+        }
+    }
+    LOG(DEBUG) << "loaded " << gameInfos_.size() << " game infos";
+}
+
+bool Cache::hasGameInfo(std::string const& gameName)
+{
+    return findGameInfo(gameName) != 0;
+}
+
+GameInfo const* Cache::findGameInfo(std::string const& gameName)
+{
+    std::string const key = gameInfoKey(gameName);
+    if (key.empty())
+    {
+        return 0;
+    }
+    auto it = gameInfos_.find(key);
+    return (it != gameInfos_.end() && it->second.hasOptions_) ? &it->second : 0;
+}
+
+GameInfo const& Cache::getGameInfo(std::string const& gameName)
+{
+    std::string const key = gameInfoKey(gameName);
+    if (key.empty())
+    {
+        LOG(WARNING) << "game not found:" << gameName;
+        throw std::runtime_error("game not found: " + gameName);
+    }
+
+    auto it = gameInfos_.find(key);
+    if (it != gameInfos_.end() && it->second.hasOptions_)
+    {
+        return it->second;
+    }
+
+    // not cached or stored by older version without options
+    GameInfo const gameInfo = model_.getGameInfo(gameName);
+    if (gamePack_)
+    {
+        std::string record;
+        gameInfo.serialize(record);
+        try
+        {
+            gamePack_->put(key, record.data(), record.size());
+        }
+        catch (std::exception const & e)
+        {
+            LOG(WARNING) << "failed to store game info " << key << ": " << e.what();
+        }
+    }
+    return gameInfos_[key] = gameInfo;
+}
+
+void Cache::preloadGameInfo(std::string const& gameName)
+{
+    if (gameName.empty() || !preloadQueued_.insert(gameName).second)
+    {
+        return;
+    }
+    preloadQueue_.push_back(gameName);
+    if (preloadQueue_.size() > preloadQueueMax)
+    {
+        preloadQueued_.erase(preloadQueue_.front());
+        preloadQueue_.pop_front();
+    }
+    Fl::remove_timeout(preloadNext, this);
+    Fl::add_timeout(preloadDelay, preloadNext, this);
+}
+
+void Cache::preloadNext(void * data)
+{
+    Cache * cache = static_cast<Cache*>(data);
+    if (cache->preloadQueue_.empty())
+    {
+        return;
+    }
+
+    // unitsync is not thread safe, one game per timeout and only when the user is not browsing battles
+    std::string const gameName = cache->preloadQueue_.front();
+    cache->preloadQueue_.pop_front();
+    cache->preloadQueued_.erase(gameName);
+
+    // games not downloaded are skipped, they are queued again next time they are seen
+    if (!cache->gameInfoKey(gameName).empty() && !cache->hasGameInfo(gameName))
+    {
+        try
+        {
+            cache->getGameInfo(gameName);
+            cache->gameInfoLoadedSignal_(gameName);
+        }
+        catch (std::exception const & e)
+        {
+            LOG(WARNING) << "failed to preload game info " << gameName << ": " << e.what();
+        }
+    }
+
+    if (!cache->preloadQueue_.empty())
+    {
+        Fl::repeat_timeout(preloadDelay, preloadNext, data);
+    }
+}
+
+bool Cache::hasMapInfo(std::string const& mapName)
+{
+    // all stored map infos are loaded at startup, infos stored by older versions lack metal spots
+    auto it = mapInfos_.find(mapInfoKey(mapName));
+    return it != mapInfos_.end() && it->second.hasMetalSpots_;
+}
+
+bool Cache::hasImage(std::string const & key)
+{
+    if (key.empty())
+    {
+        return false;
+    }
+
+    return images_.count(key) > 0 || (imagePack_ && imagePack_->has(key));
+}
+
+bool Cache::hasMapImage(std::string const & mapName)
+{
+    return hasImage(mapImageKey(mapName, MAP_IMAGE_MIN_SIZE));
+}
+
+bool Cache::hasMetalImage(std::string const & mapName)
+{
+    return hasImage(imageKey(mapName, "metal_128"));
 }
 
 bool Cache::hasHeightImage(std::string const & mapName)
 {
-    std::string const path = pathHeightImage(mapName);
+    return hasImage(imageKey(mapName, "height_128"));
+}
 
-    return !path.empty() && (Fl_Shared_Image::find(path.c_str()) || boost::filesystem::exists(path));
+Fl_Shared_Image * Cache::loadImage(std::string const & key)
+{
+    auto it = images_.find(key);
+    if (it != images_.end())
+    {
+        ++stats_.hits_;
+        lru_.splice(lru_.begin(), lru_, it->second.lru_);
+        return Fl_Shared_Image::find(key.c_str()); // increments refcount
+    }
+
+    if (!imagePack_)
+    {
+        return 0;
+    }
+
+    std::size_t size;
+    uint8_t const * data = imagePack_->get(key, size);
+    if (data)
+    {
+        int w, h, d;
+        std::size_t const headerSize = MyImage::parseHeader(data, size, w, h, d);
+        if (headerSize > 0)
+        {
+            return addImage(key, new PackedImage(key, data + headerSize, w, h, d, false));
+        }
+        LOG(WARNING) << "bad image in pack: " << key;
+    }
+    return 0;
 }
 
-Fl_Shared_Image * Cache::getMapImage(std::string const & mapName)
+Fl_Shared_Image * Cache::addImage(std::string const & key, Fl_Shared_Image * image)
 {
-    std::string const path = pathMapImage(mapName);
-    if (path.empty()) return 0;
+    ++stats_.misses_;
 
-    Fl_Shared_Image * image = Fl_Shared_Image::get(path.c_str());
+    lru_.push_front(key);
+    CachedImage const cached = { image, static_cast<std::size_t>(image->w())*image->h()*image->d(), lru_.begin() };
+    images_[key] = cached;
+    stats_.bytes_ += cached.bytes_;
+    stats_.images_ = images_.size();
 
-    if (image == 0)
+    Fl_Shared_Image * res = Fl_Shared_Image::find(key.c_str()); // reference for caller
+    trimImages();
+    return res;
+}
+
+void Cache::trimImages()
+{
+    auto it = lru_.end();
+    while (stats_.bytes_ > imageBudget_ && it != lru_.begin())
     {
-        // get 1024x1024 since higher mip levels can result in broken image, e.g. TinySkirmish
-        int const mipLevel = 0;
-        int const imageSize = 1024 >> mipLevel;
+        --it;
+        auto itImage = images_.find(*it);
+        assert(itImage != images_.end());
+        CachedImage const& cached = itImage->second;
 
-        auto imageData = model_.getMapImage(mapName, mipLevel);
-        if (imageData)
+        // keep images still used by someone, e.g. shown in a widget
+        if (cached.image_->refcount() > 1)
         {
-            // get real dimensions (minimap is always a square)
-            int w,h;
-            model_.getMapSize(mapName, w, h);
+            continue;
+        }
+
+        cached.image_->release();
+        stats_.bytes_ -= cached.bytes_;
+        ++stats_.evictions_;
+        images_.erase(itImage);
+        it = lru_.erase(it);
+    }
+    stats_.images_ = images_.size();
+}
 
-            createImageFile(imageData.get(), imageSize, imageSize, 3, path, static_cast<double>(w)/h);
+Fl_Shared_Image * Cache::storeImage(std::string const & key, uint8_t const * data, int w, int h, int d)
+{
+    assert(w > 0 && h > 0 && (d == 1 || d == 3));
 
-            image = Fl_Shared_Image::get(path.c_str());
-            if (image == 0)
+    if (imagePack_)
+    {
+        std::string const header = MyImage::header(w, h, d);
+        std::size_t const size = static_cast<std::size_t>(w)*h*d;
+        std::vector<uint8_t> record(header.size() + size);
+        std::memcpy(&record[0], header.data(), header.size());
+        std::memcpy(&record[header.size()], data, size);
+        try
+        {
+            imagePack_->put(key, &record[0], record.size());
+            Fl_Shared_Image * image = loadImage(key);
+            if (image)
             {
-                throw std::runtime_error("Fl_Shared_Image::get failed:" + path);
+                return image;
             }
         }
+        catch (std::exception const & e)
+        {
+            LOG(WARNING) << "failed to store image " << key << ": " << e.what();
+        }
+    }
+
+    // not cached on disk, keep it in memory only
+    return addImage(key, new PackedImage(key, data, w, h, d, true));
+}
+
+int Cache::mapImageLevel(int size)
+{
+    int level = MAP_IMAGE_MIN_SIZE;
+    while (level*2 <= size && level < MAP_IMAGE_MAX_SIZE)
+    {
+        level *= 2;
+    }
+    return level;
+}
+
+std::string Cache::mapImageKey(std::string const & mapName, int level)
+{
+    return imageKey(mapName, "minimap_" + std::to_string(level));
+}
+
+Fl_Shared_Image * Cache::getMapImage(std::string const & mapName, int size)
+{
+    int const level = mapImageLevel(size);
+    std::string const key = mapImageKey(mapName, level);
+    if (key.empty()) return 0;
+
+    Fl_Shared_Image * image = loadImage(key);
+
+    if (image == 0)
+    {
+        image = createMapImages(mapName, level);
+    }
+    return image;
+}
+
+Fl_Shared_Image * Cache::createMapImages(std::string const & mapName, int level)
+{
+    // get 1024x1024 since higher mip levels can result in broken image, e.g. TinySkirmish
+    int const mipLevel = 0;
+    int const imageSize = 1024 >> mipLevel;
+
+    // get real dimensions (minimap is always a square)
+    int w,h;
+    model_.getMapSize(mapName, w, h);
+    double const r = static_cast<double>(w)/h;
+
+    int w2, h2;
+    scaledSize(imageSize, imageSize, r, level, w2, h2);
+
+    // converted and scaled in one pass
+    std::unique_ptr<uint8_t[]> imageData = model_.getMapImage(mapName, mipLevel, w2, h2);
+    if (!imageData)
+    {
+        return 0;
+    }
+    Fl_Shared_Image * image = storeImage(mapImageKey(mapName, level), imageData.get(), w2, h2, 3);
+
+    // each smaller level is scaled from the one above, smaller levels already stored are kept
+    for (int l = level/2; l >= MAP_IMAGE_MIN_SIZE; l /= 2)
+    {
+        std::string const key = mapImageKey(mapName, l);
+        if (hasImage(key))
+        {
+            break;
+        }
+
+        int wl, hl;
+        scaledSize(imageSize, imageSize, r, l, wl, hl);
+        std::unique_ptr<uint8_t[]> scaled(new uint8_t[wl*hl*3]);
+        Resample::area(imageData.get(), w2, h2, 3, scaled.get(), wl, hl);
+
+        Fl_Shared_Image * im = storeImage(key, scaled.get(), wl, hl, 3);
+        im->release();
+
+        imageData = std::move(scaled);
+        w2 = wl;
+        h2 = hl;
     }
+
     return image;
 }
 
 Fl_Shared_Image * Cache::getMetalImage(std::string const & mapName)
 {
-    std::string const path = pathMetalImage(mapName);
-    if (path.empty()) return 0;
+    std::string const key = imageKey(mapName, "metal_128");
+    if (key.empty()) return 0;
 
-    Fl_Shared_Image * image = Fl_Shared_Image::get(path.c_str());
+    Fl_Shared_Image * image = loadImage(key);
 
     if (image == 0)
     {
@@ -165,22 +951,16 @@ Fl_Shared_Image * Cache::getMetalImage(std::string const & mapName)
         auto imageData = model_.getMetalMap(mapName, w, h);
         if (imageData)
         {
-            // create RGB data to get a green metal map
-            std::unique_ptr<uint8_t[]> rgb(new uint8_t[3*w*h]);
-            for (int i=0; i<w*h; ++i)
-            {
-                rgb[i*3+0] = 0;
-                rgb[i*3+1] = imageData[i];
-                rgb[i*3+2] = 0;
-            }
+            int w2, h2;
+            scaledSize(w, h, 1, MAP_IMAGE_MIN_SIZE, w2, h2);
+            std::unique_ptr<uint8_t[]> scaled(new uint8_t[w2*h2]);
+            Resample::area(imageData.get(), w, h, 1, scaled.get(), w2, h2);
 
-            createImageFile(rgb.get(), w, h, 3, path);
+            // create RGB data to get a green metal map
+            std::unique_ptr<uint8_t[]> rgb(new uint8_t[3*w2*h2]);
+            PixelKernels::grayToRgb(scaled.get(), rgb.get(), w2*h2, 1);
 
-            image = Fl_Shared_Image::get(path.c_str());
-            if (image == 0)
-            {
-                throw std::runtime_error("Fl_Shared_Image::get failed:" + path);
-            }
+            image = storeImage(key, rgb.get(), w2, h2, 3);
         }
     }
     return image;
@@ -188,10 +968,10 @@ Fl_Shared_Image * Cache::getMetalImage(std::string const & mapName)
 
 Fl_Shared_Image * Cache::getHeightImage(std::string const & mapName)
 {
-    std::string const path = pathHeightImage(mapName);
-    if (path.empty()) return 0;
+    std::string const key = imageKey(mapName, "height_128");
+    if (key.empty()) return 0;
 
-    Fl_Shared_Image * image = Fl_Shared_Image::get(path.c_str());
+    Fl_Shared_Image * image = loadImage(key);
 
     if (image == 0)
     {
@@ -199,32 +979,37 @@ Fl_Shared_Image * Cache::getHeightImage(std::string const & mapName)
         auto imageData = model_.getHeightMap(mapName, w, h);
         if (imageData)
         {
-            createImageFile(imageData.get(), w, h, 1, path);
+            int w2, h2;
+            scaledSize(w, h, 1, MAP_IMAGE_MIN_SIZE, w2, h2);
+            std::unique_ptr<uint8_t[]> scaled(new uint8_t[w2*h2]);
+            Resample::area(imageData.get(), w, h, 1, scaled.get(), w2, h2);
 
-            image = Fl_Shared_Image::get(path.c_str());
-            if (image == 0)
-            {
-                throw std::runtime_error("Fl_Shared_Image::get failed:" + path);
-            }
+            image = storeImage(key, scaled.get(), w2, h2, 1);
         }
     }
     return image;
 }
 
-void Cache::createImageFile(uint8_t const * data, int w, int h, int d, std::string const & path, double r /* w/h */)
+void Cache::addMetalSpots(std::string const & mapName, MapInfo & mapInfo)
 {
-    assert(w > 0 && h > 0 && (d == 1 || d == 3) && r > 0);
+    int w, h;
+    auto metalMap = model_.getMetalMap(mapName, w, h);
+    if (metalMap)
+    {
+        mapInfo.metalSpots_ = MetalSpots::find(metalMap.get(), w, h);
+    }
+    // also set when metal map is not available to not retry every time
+    mapInfo.hasMetalSpots_ = true;
+}
 
-    // create image, we will resize it below
-    Magick::Image image;
-    image.read(w, h, d == 1 ? "I" : "RGB", Magick::CharPixel, data);
-    image.depth(8);
+void Cache::scaledSize(int w, int h, double r /* w/h */, int maxSize, int & w2, int & h2)
+{
+    assert(w > 0 && h > 0 && r > 0);
 
     double const r2 = static_cast<double>(w)/h * r;
 
-    int const maxSize = 128;
-    int w2 = maxSize;
-    int h2 = maxSize;
+    w2 = maxSize;
+    h2 = maxSize;
 
     if (r2 < 1)
     {
@@ -234,13 +1019,22 @@ void Cache::createImageFile(uint8_t const * data, int w, int h, int d, std::stri
     {
         h2 /= r2;
     }
-    assert(w2 > 0 && h2 > 0);
+    w2 = std::max(w2, 1);
+    h2 = std::max(h2, 1);
+}
+
+MapInfo const * Cache::findMapInfo(std::string const & mapName)
+{
+    unsigned int const chksum = model_.getMapChecksum(mapName);
+    if (chksum == 0)
+    {
+        return 0;
+    }
 
-    // resize and write
-    Magick::Geometry geom(w2, h2);
-    geom.aspect(true);
-    image.resize(geom);
-    image.write(path);
+    std::ostringstream oss;
+    oss << mapName << "_" << chksum;
+    auto it = mapInfos_.find(oss.str());
+    return it == mapInfos_.end() ? 0 : &it->second;
 }
 
 MapInfo const & Cache::getMapInfo(std::string const & mapName)
@@ -248,35 +1042,49 @@ MapInfo const & Cache::getMapInfo(std::string const & mapName)
     std::string const key = mapInfoKey(mapName);
 
     auto it = mapInfos_.find(key);
-    if (it != mapInfos_.end())
+    if (it != mapInfos_.end() && it->second.hasMetalSpots_)
     {
         // loaded into memory
         return it->second;
     }
-    else
+
+    MapInfo mapInfo;
+    bool found = false;
+
+    if (it != mapInfos_.end())
     {
-        std::string const path = pathMapInfo(mapName);
+        // stored by older version, only metal spots missing
+        mapInfo = it->second;
+        found = true;
+    }
 
+    if (!found)
+    {
+        // info file written by older flobby versions
+        std::string const path = pathMapInfo(mapName);
         std::ifstream ifs(path);
         if (ifs.good())
         {
-            // map info file found
-            MapInfo mapInfo;
-            ifs >> mapInfo;
-            return mapInfos_[key] = mapInfo;
-        }
-        else
-        {
-            // create map info file
-            MapInfo const mapInfo = model_.getMapInfo(mapName);
-            std::ofstream ofs(path);
-            if (!ofs.good())
+            try
             {
-                LOG(WARNING) << "failed to open mapInfo file for writing:" << path;
-                throw std::runtime_error("failed to open mapInfo file for writing: " + path);
+                ifs >> mapInfo;
+                found = true;
+            }
+            catch (std::exception const & e)
+            {
+                LOG(WARNING) << "bad map info file " << path << ": " << e.what();
             }
-            ofs << mapInfo;
-            return mapInfos_[key] = mapInfo;
         }
     }
+
+    if (!found)
+    {
+        mapInfo = model_.getMapInfo(mapName);
+    }
+
+    addMetalSpots(mapName, mapInfo);
+    storeMapInfo(key, mapInfo);
+    MapInfo const & cached = mapInfos_[key] = mapInfo;
+    mapInfoCachedSignal_(mapName);
+    return cached;
 }
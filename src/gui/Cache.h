@@ -3,11 +3,23 @@
 #pragma once
 
 #include "model/MapInfo.h"
+#include "model/GameInfo.h"
+#include "model/ContentIndex.h"
 
-#include <map>
+#include <boost/signals2/signal.hpp>
+#include <atomic>
+#include <ctime>
+#include <deque>
+#include <list>
+#include <memory>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 class Model;
+class PackFile;
 class Fl_Shared_Image;
 
 class Cache
@@ -16,29 +28,140 @@ public:
     Cache(Model & model);
     virtual ~Cache();
 
-    // has* methods below returns true if cache entry is loaded or cache file exist
-    bool hasMapInfo(std::string const& mapName);
+    // has* methods below returns true if cache entry is loaded or stored on disk
+    bool hasMapInfo(std::string const& mapName); // including metal spots
     bool hasMapImage(std::string const& mapName);
     bool hasMetalImage(std::string const& mapName);
     bool hasHeightImage(std::string const& mapName);
 
     MapInfo const&   getMapInfo(std::string const& mapName);
-    Fl_Shared_Image* getMapImage(std::string const& mapName); // returns 0 if map not found
+    MapInfo const*   findMapInfo(std::string const& mapName); // returns 0 if not cached, never calls unitsync GetMapInfo
+
+    typedef boost::signals2::signal<void (std::string const& mapName)> MapInfoCachedSignal; // emitted by getMapInfo
+    boost::signals2::connection connectMapInfoCached(MapInfoCachedSignal::slot_type subscriber)
+    { return mapInfoCachedSignal_.connect(subscriber); }
+
+    // get*Image returns a shared image with one reference for the caller, returns 0 if map not found
+    // map images are stored in sizes 128, 256, 512 and 1024, getMapImage returns the largest not bigger than
+    // size (at least 128), larger sizes are generated the first time they are requested
+    static int const MAP_IMAGE_MIN_SIZE = 128;
+    static int const MAP_IMAGE_MAX_SIZE = 1024;
+    Fl_Shared_Image* getMapImage(std::string const& mapName, int size = MAP_IMAGE_MIN_SIZE);
     Fl_Shared_Image* getMetalImage(std::string const& mapName);
     Fl_Shared_Image* getHeightImage(std::string const& mapName);
 
+    // game infos (AIs, sides and options) are kept in memory and on disk keyed by game checksum so unitsync only
+    // has to mount the game archives the first time a game is seen
+    bool hasGameInfo(std::string const& gameName); // including options
+    GameInfo const& getGameInfo(std::string const& gameName); // throws if game not found
+    GameInfo const* findGameInfo(std::string const& gameName); // returns 0 if not cached, never mounts the game
+    // queues games the user selected or joined for loading their game info in idle time, returns immediately
+    void preloadGameInfo(std::string const& gameName);
+
+    typedef boost::signals2::signal<void (std::string const& gameName)> GameInfoLoadedSignal; // emitted by preload
+    boost::signals2::connection connectGameInfoLoaded(GameInfoLoadedSignal::slot_type subscriber)
+    { return gameInfoLoadedSignal_.connect(subscriber); }
+
+    // the cache keeps a reference to recently used images, images not used by anyone else
+    // are released in least recently used order when their total size exceeds the budget
+    void imageBudget(std::size_t megaBytes);
+    std::size_t imageBudget() const; // MB
+
+    struct Stats
+    {
+        Stats(): hits_(0), misses_(0), evictions_(0), bytes_(0), images_(0) {}
+        std::size_t hits_; // image already loaded
+        std::size_t misses_; // image loaded from pack or generated
+        std::size_t evictions_;
+        std::size_t bytes_; // pixel bytes of images held by cache
+        std::size_t images_; // images held by cache
+    };
+    Stats const& stats() const { return stats_; }
+
+    // removes entries of maps no longer available, also removes files written by older versions,
+    // map images of least recently used maps are removed when the disk budget is exceeded,
+    // entries are removed and files compacted in a background thread
+    void collectGarbage();
+    void diskBudget(std::size_t megaBytes);
+    std::size_t diskBudget() const; // MB
+
 private:
     Model & model_;
-    std::map<std::string, MapInfo> mapInfos_;
+    std::unordered_map<std::string, MapInfo> mapInfos_; // key is mapInfoKey()
+    std::unique_ptr<PackFile> infoPack_; // binary MapInfo records
+    std::unique_ptr<PackFile> imagePack_; // all map images, key is imageKey()
+    MapInfoCachedSignal mapInfoCachedSignal_;
+
+    std::unordered_map<std::string, GameInfo> gameInfos_; // key is gameInfoKey()
+    std::unique_ptr<PackFile> gamePack_; // binary GameInfo records
+    std::deque<std::string> preloadQueue_; // game names
+    std::unordered_set<std::string> preloadQueued_; // game names in preloadQueue_
+    GameInfoLoadedSignal gameInfoLoadedSignal_;
+
+    struct CachedImage
+    {
+        Fl_Shared_Image* image_;
+        std::size_t bytes_;
+        std::list<std::string>::iterator lru_;
+    };
+    std::unordered_map<std::string, CachedImage> images_;
+    std::list<std::string> lru_; // most recently used first
+    std::size_t imageBudget_; // bytes
+    Stats stats_;
+
+    std::size_t diskBudget_; // bytes
+    std::unordered_map<std::string, std::time_t> accessTimes_; // key is mapInfoKey(), last use of map entries
+    std::atomic<bool> gcRunning_;
+    std::thread gcThread_;
+
+    // copy of what the gc thread needs, it only writes gcRemovedMaps_ and gcRemovedGames_
+    struct GcJob
+    {
+        std::string infoPath_; // empty if pack not available
+        std::string imagePath_;
+        std::string gamePath_;
+        std::string dir_;
+        std::unordered_set<std::string> liveMaps_; // mapInfoKey() of installed maps
+        ContentIndex contentIndex_; // checksums of games looked up so far
+        std::unordered_map<std::string, std::time_t> accessTimes_;
+        std::size_t diskBudget_;
+        std::unordered_set<std::string> keepFiles_;
+    };
+    std::vector<std::string> gcRemovedMaps_; // keys removed from packs by gc thread, erased from memory by checkGc
+    std::vector<std::string> gcRemovedGames_;
 
     std::string mapDir();
+    std::string gameDir();
+    std::string gameInfoKey(std::string const& gameName); // returns "<gamename>_<chksum>", empty string if game not found
+    void loadGameInfos();
+    static void preloadNext(void * data); // timeout handler, loads one queued game info
     std::string mapInfoKey(std::string const& mapName); // returns "<mapname>_<chksum>", throws if map not found
 
-    std::string pathMapInfo(std::string const& mapName);
-    std::string pathMapImage(std::string const& mapName);
-    std::string pathMetalImage(std::string const& mapName);
-    std::string pathHeightImage(std::string const& mapName);
+    std::string pathMapInfo(std::string const& mapName); // file used by older versions
+    void loadMapInfos();
+    std::string pathAccessTimes();
+    void loadAccessTimes();
+    void saveAccessTimes();
+    void touch(std::string const& mapKey);
+    // run in gc thread
+    static void removeStale(GcJob const& job, std::vector<std::string> & removedMaps, std::vector<std::string> & removedGames);
+    static void evictMapImages(GcJob const& job, PackFile & imagePack, std::size_t infoSize);
+    // removes files in dir except pack files and keepFiles and compacts the pack files
+    static void cleanFiles(std::vector<std::string> const& packPaths, std::string const& dir, std::unordered_set<std::string> const& keepFiles);
+    static void checkGc(void * data); // timeout handler, reloads pack files when gc thread is done
+    void storeMapInfo(std::string const& key, MapInfo const& mapInfo);
+    void addMetalSpots(std::string const& mapName, MapInfo & mapInfo);
     std::string mapPath(std::string const& mapName, std::string const& suffix); // returns empty string if map do not exist
 
-    void createImageFile(uint8_t const* data, int w, int h, int d, std::string const& path, double r = 1 /* w/h */);
+    // size of a w x h image scaled to fit in maxSize x maxSize, r is the extra aspect ratio to apply
+    static void scaledSize(int w, int h, double r /* w/h */, int maxSize, int & w2, int & h2);
+    static int mapImageLevel(int size); // returns map image size to use for size
+    std::string mapImageKey(std::string const& mapName, int level);
+    Fl_Shared_Image* createMapImages(std::string const& mapName, int level); // creates level and missing smaller levels
+    std::string imageKey(std::string const& mapName, std::string const& type); // returns "<mapname>_<chksum>_<type>", empty string if map do not exist
+    bool hasImage(std::string const& key);
+    Fl_Shared_Image* loadImage(std::string const& key); // from memory or pack, returns 0 if not cached
+    Fl_Shared_Image* storeImage(std::string const& key, uint8_t const* data, int w, int h, int d);
+    Fl_Shared_Image* addImage(std::string const& key, Fl_Shared_Image* image); // takes over reference, returns new reference for caller
+    void trimImages();
 };
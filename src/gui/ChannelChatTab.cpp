@@ -36,6 +36,7 @@ ChannelChatTab::ChannelChatTab(int x, int y, int w, int h, std::string const & c
     Fl_Group * left = new Fl_Group(x, y, leftW, h);
     int const ih = FL_NORMAL_SIZE*2; // input height
     text_ = new TextDisplay2(x, y, leftW, h-ih, &logFile_);
+    text_->loadHistory();
     input_ = new ChatInput(x, y+h-ih, leftW, ih);
     input_->connectText( boost::bind(&ChannelChatTab::onInput, this, _1) );
     input_->connectComplete( boost::bind(&ChannelChatTab::onComplete, this, _1, _2, _3, _4) );
@@ -61,6 +62,7 @@ ChannelChatTab::ChannelChatTab(int x, int y, int w, int h, std::string const & c
     model_.connectUserJoinedChannel( boost::bind(&ChannelChatTab::userJoined, this, _1, _2) );
     model_.connectUserLeftChannel( boost::bind(&ChannelChatTab::userLeft, this, _1, _2, _3) );
     model_.connectSaidChannel( boost::bind(&ChannelChatTab::said, this, _1, _2, _3) );
+    model_.connectChannelUserChanged(channelName_, boost::bind(&UserList::userChanged, userList_, _1) );
 }
 
 ChannelChatTab::~ChannelChatTab()
@@ -132,6 +134,7 @@ void ChannelChatTab::clients(std::string const & channelName, std::vector<std::s
 {
     if (channelName == channelName_)
     {
+        StringTable::Update update(*userList_);
         for (std::string const & userName : clients)
         {
             // catch non-existing user exception here (uberserver bug) to not skip the rest of users in channel
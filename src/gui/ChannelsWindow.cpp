@@ -22,7 +22,7 @@ ChannelsWindow::ChannelsWindow(Model & model):
     channelsRetrieved_(false)
 {
     channelList_ = new StringTable(0, 0, 100, 100, "ChannelList",
-            { {"name",10}, {"users",4}, {"topic",30} }, 0 /* sort on name by default */);
+            { {"name",10}, {"users",4, StringTableColumnDef::SK_INTEGER}, {"topic",30} }, 0 /* sort on name by default */);
 
     model_.connectChannels( boost::bind(&ChannelsWindow::onChannels, this, _1) );
 
@@ -56,6 +56,7 @@ void ChannelsWindow::callback(Fl_Widget*, void *data)
 
 void ChannelsWindow::onChannels(Channels const & channels)
 {
+    StringTable::Update update(*channelList_);
     channelList_->clear();
     for (Channel const & channel : channels)
     {
@@ -0,0 +1,194 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "ChatBuffer.h"
+
+#include <cassert>
+#include <stdexcept>
+
+ChatBuffer::ChatBuffer(Wrap wrap, std::size_t chunkLines):
+    wrap_(wrap),
+    chunkLines_(chunkLines),
+    frontGap_(0),
+    firstLine_(0),
+    lineCount_(0),
+    chars_(0),
+    rows_(0),
+    width_(0)
+{
+    assert(chunkLines_ > 0);
+}
+
+void ChatBuffer::append(std::string const & text, std::size_t timeLength, int style, std::size_t logBegin, std::size_t logEnd)
+{
+    std::size_t const capacity = chunkLines_ - (chunks_.size() == 1 ? frontGap_ : 0);
+    if (chunks_.empty() || chunks_.back().lines_.size() == capacity)
+    {
+        chunks_.push_back(Chunk { {}, 0, 0 });
+        chunks_.back().lines_.reserve(chunkLines_);
+    }
+
+    Chunk & chunk = chunks_.back();
+    chunk.lines_.push_back(Line { text, timeLength, style, logBegin, logEnd, {} });
+    added(chunk, chunk.lines_.back());
+}
+
+void ChatBuffer::prepend(std::string const & text, std::size_t timeLength, int style, std::size_t logBegin, std::size_t logEnd)
+{
+    if (chunks_.empty() || frontGap_ == 0)
+    {
+        chunks_.push_front(Chunk { {}, 0, 0 });
+        chunks_.front().lines_.reserve(chunkLines_);
+        frontGap_ = chunkLines_;
+    }
+
+    Chunk & chunk = chunks_.front();
+    chunk.lines_.insert(chunk.lines_.begin(), Line { text, timeLength, style, logBegin, logEnd, {} });
+    --frontGap_;
+    added(chunk, chunk.lines_.front());
+}
+
+void ChatBuffer::added(Chunk & chunk, Line & line)
+{
+    if (width_ > 0)
+    {
+        line.breaks_ = wrap_(line, width_);
+    }
+
+    chunk.chars_ += line.text_.size();
+    chunk.rows_ += line.rows();
+    chars_ += line.text_.size();
+    rows_ += line.rows();
+    ++lineCount_;
+}
+
+std::size_t ChatBuffer::trim(std::size_t maxChars)
+{
+    std::size_t dropped = 0;
+    while (chunks_.size() > 1 && chars_ - chunks_.front().chars_ >= maxChars)
+    {
+        Chunk const & chunk = chunks_.front();
+        firstLine_ += chunk.lines_.size();
+        lineCount_ -= chunk.lines_.size();
+        chars_ -= chunk.chars_;
+        rows_ -= chunk.rows_;
+        dropped += chunk.rows_;
+        chunks_.pop_front();
+        frontGap_ = 0;
+    }
+    return dropped;
+}
+
+std::size_t ChatBuffer::trimBack(std::size_t maxChars)
+{
+    std::size_t dropped = 0;
+    while (chunks_.size() > 1 && chars_ - chunks_.back().chars_ >= maxChars)
+    {
+        Chunk const & chunk = chunks_.back();
+        lineCount_ -= chunk.lines_.size();
+        chars_ -= chunk.chars_;
+        rows_ -= chunk.rows_;
+        dropped += chunk.rows_;
+        chunks_.pop_back();
+    }
+    return dropped;
+}
+
+void ChatBuffer::clear()
+{
+    firstLine_ += lineCount_;
+    chunks_.clear();
+    frontGap_ = 0;
+    lineCount_ = 0;
+    chars_ = 0;
+    rows_ = 0;
+}
+
+ChatBuffer::Line const & ChatBuffer::line(std::size_t n) const
+{
+    if (n < firstLine_ || n >= endLine())
+    {
+        throw std::out_of_range("line not in chat buffer");
+    }
+    std::size_t const slot = n - firstLine_ + frontGap_;
+    std::size_t const chunkIndex = slot / chunkLines_;
+    return chunks_[chunkIndex].lines_[slot % chunkLines_ - (chunkIndex == 0 ? frontGap_ : 0)];
+}
+
+void ChatBuffer::width(int width)
+{
+    if (width != width_)
+    {
+        width_ = width;
+        rewrap();
+    }
+}
+
+void ChatBuffer::rewrap()
+{
+    rows_ = 0;
+    for (auto & chunk : chunks_)
+    {
+        chunk.rows_ = 0;
+        for (auto & line : chunk.lines_)
+        {
+            line.breaks_.clear();
+            if (width_ > 0)
+            {
+                line.breaks_ = wrap_(line, width_);
+            }
+            chunk.rows_ += line.rows();
+        }
+        rows_ += chunk.rows_;
+    }
+}
+
+std::pair<std::size_t, std::size_t> ChatBuffer::findRow(std::size_t row) const
+{
+    if (row >= rows_)
+    {
+        throw std::out_of_range("row not in chat buffer");
+    }
+
+    std::size_t n = firstLine_;
+    for (auto const & chunk : chunks_)
+    {
+        if (row >= chunk.rows_)
+        {
+            row -= chunk.rows_;
+            n += chunk.lines_.size();
+            continue;
+        }
+        for (auto const & line : chunk.lines_)
+        {
+            if (row < line.rows())
+            {
+                return std::make_pair(n, row);
+            }
+            row -= line.rows();
+            ++n;
+        }
+    }
+    assert(false);
+    return std::make_pair(n, 0);
+}
+
+std::size_t ChatBuffer::rowOf(std::size_t n) const
+{
+    std::size_t row = 0;
+    std::size_t const slot = n - firstLine_ + frontGap_;
+    std::size_t const chunkIndex = slot / chunkLines_;
+    for (std::size_t c = 0; c < chunkIndex && c < chunks_.size(); ++c)
+    {
+        row += chunks_[c].rows_;
+    }
+    if (chunkIndex < chunks_.size())
+    {
+        auto const & lines = chunks_[chunkIndex].lines_;
+        std::size_t const index = slot % chunkLines_ - (chunkIndex == 0 ? frontGap_ : 0);
+        for (std::size_t i = 0; i < index && i < lines.size(); ++i)
+        {
+            row += lines[i].rows();
+        }
+    }
+    return row;
+}
@@ -0,0 +1,74 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Lines of a chat view stored in chunks of lines so old lines are dropped a chunk at a time.
+// Lines are numbered from the first line ever added so numbers stay valid when old lines are dropped,
+// prepending older lines shifts the numbers of the lines after them.
+// Each line keeps where it wraps for the current width, rows are wrapped lines.
+class ChatBuffer
+{
+public:
+    struct Line
+    {
+        std::string text_;
+        std::size_t timeLength_; // time stamp at start of text_, drawn with its own style
+        int style_; // of text after time stamp
+        std::size_t logBegin_; // offsets of line in log file, equal if not logged
+        std::size_t logEnd_;
+        std::vector<std::size_t> breaks_; // offsets in text_ of wrapped rows after the first
+
+        std::size_t rows() const { return breaks_.size() + 1; }
+        std::size_t rowBegin(std::size_t row) const { return row == 0 ? 0 : breaks_[row - 1]; }
+        std::size_t rowEnd(std::size_t row) const { return row < breaks_.size() ? breaks_[row] : text_.size(); }
+    };
+
+    // returns offsets where wrapped rows after the first start
+    typedef std::function<std::vector<std::size_t> (Line const & line, int width)> Wrap;
+
+    explicit ChatBuffer(Wrap wrap, std::size_t chunkLines = 64);
+
+    void append(std::string const & text, std::size_t timeLength, int style, std::size_t logBegin = 0, std::size_t logEnd = 0);
+    void prepend(std::string const & text, std::size_t timeLength, int style, std::size_t logBegin = 0, std::size_t logEnd = 0);
+    std::size_t trim(std::size_t maxChars); // drops old chunks while the rest has maxChars, returns rows dropped
+    std::size_t trimBack(std::size_t maxChars); // same for new chunks
+    void clear();
+
+    bool empty() const { return lineCount_ == 0; }
+    std::size_t chars() const { return chars_; }
+    std::size_t firstLine() const { return firstLine_; }
+    std::size_t endLine() const { return firstLine_ + lineCount_; } // one past last line
+    Line const & line(std::size_t n) const; // firstLine() <= n < endLine()
+
+    void width(int width); // wraps all lines again if changed
+    void rewrap(); // e.g. when font changed
+    std::size_t rows() const { return rows_; }
+    std::pair<std::size_t, std::size_t> findRow(std::size_t row) const; // line and row in line of row < rows()
+    std::size_t rowOf(std::size_t n) const; // first row of line n
+
+private:
+    struct Chunk
+    {
+        std::vector<Line> lines_;
+        std::size_t chars_;
+        std::size_t rows_;
+    };
+
+    Wrap wrap_;
+    std::size_t const chunkLines_;
+    std::deque<Chunk> chunks_; // all but first and last are full
+    std::size_t frontGap_; // lines missing at start of first chunk
+    std::size_t firstLine_; // number of first line of first chunk
+    std::size_t lineCount_;
+    std::size_t chars_;
+    std::size_t rows_;
+    int width_; // 0 until known, lines are not wrapped then
+
+    void added(Chunk & chunk, Line & line);
+};
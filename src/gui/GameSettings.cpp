@@ -6,9 +6,17 @@
 
 #include <boost/bind.hpp>
 #include <boost/algorithm/string.hpp>
+#include <cstring>
+
+// game options are set in script tags as modoptions/<key>, zero-k sends the option key only
+static char const * ModOptionsPrefix = "modoptions/";
 
 GameSettings::GameSettings(int x, int y, int w, int h, Model & model):
-    StringTable(x, y, w, h, "GameSettings", { {"setting",12}, {"value",6} }, 0 /* sort on setting by default */),
+    StringTable(x, y, w, h, "GameSettings",
+                { {"setting",12},
+                  {"value",6, StringTableColumnDef::SK_NATURAL},
+                  {"default",6, StringTableColumnDef::SK_NATURAL},
+                  {"description",20} }, 0 /* sort on setting by default */),
     model_(model)
 {
 //    connectRowClicked( boost::bind(&GameSettings::rowClicked, this, _1, _2) );
@@ -18,19 +26,105 @@ GameSettings::GameSettings(int x, int y, int w, int h, Model & model):
     model_.connectRemoveScriptTag( boost::bind(&GameSettings::removeScriptTag, this, _1) );
 }
 
+void GameSettings::game(GameInfo const * gameInfo)
+{
+    options_.clear();
+    optionIndex_.clear();
+    if (gameInfo)
+    {
+        for (auto const & option : gameInfo->options_)
+        {
+            if (option.type_ != GameInfo::OT_SECTION && option.type_ != GameInfo::OT_ERROR)
+            {
+                optionIndex_[option.key_] = options_.size();
+                options_.push_back(option);
+            }
+        }
+    }
+    rebuild();
+}
+
+void GameSettings::reset()
+{
+    options_.clear();
+    optionIndex_.clear();
+    tags_.clear();
+    clear();
+}
+
+void GameSettings::rebuild()
+{
+    Update update(*this);
+    clear();
+    for (auto const & option : options_)
+    {
+        addRow(makeRow(option));
+    }
+    for (auto const & pair : tags_)
+    {
+        if (rowId(pair.first) == pair.first)
+        {
+            addRow(StringTableRow(pair.first, { pair.second.first, pair.second.second, "", "" }));
+        }
+    }
+}
+
+std::string GameSettings::rowId(std::string const & key2) const
+{
+    std::string optionKey = key2;
+    if (boost::starts_with(optionKey, ModOptionsPrefix))
+    {
+        optionKey.erase(0, std::strlen(ModOptionsPrefix));
+    }
+    return optionIndex_.count(optionKey) > 0 ? ModOptionsPrefix + optionKey : key2;
+}
+
+StringTableRow GameSettings::makeRow(GameInfo::Option const & option)
+{
+    std::string const id = ModOptionsPrefix + option.key_;
+
+    // value set by host, empty means default
+    std::string value;
+    auto it = tags_.find(id);
+    if (it == tags_.end())
+    {
+        it = tags_.find(option.key_);
+    }
+    if (it != tags_.end())
+    {
+        value = option.valueText(it->second.second);
+    }
+
+    std::string const & name = option.name_.empty() ? option.key_ : option.name_;
+    return StringTableRow(id, { name, value, option.valueText(option.default_), option.desc_ });
+}
+
+void GameSettings::setRow(StringTableRow const & row)
+{
+    if (rowExist(row.id_))
+    {
+        updateRow(row);
+    }
+    else
+    {
+        addRow(row);
+    }
+}
+
 void GameSettings::setScriptTag(std::string const & key, std::string const & value)
 {
     std::string key2 = key;
     boost::to_lower(key2);
+    tags_[key2] = std::make_pair(key, value);
 
-    StringTableRow row(key2, { key, value });
-    if (rowExist(key2))
+    std::string const id = rowId(key2);
+    if (id != key2)
     {
-        updateRow(row);
+        setRow(makeRow(options_[optionIndex_[id.substr(std::strlen(ModOptionsPrefix))]]));
     }
     else
     {
-        addRow(row);
+        setRow(StringTableRow(key2, { key, value, "", "" }));
     }
 }
 
@@ -38,14 +132,25 @@ void GameSettings::removeScriptTag(std::string const & key)
 {
     if (key == "*")
     {
-        clear();
+        tags_.clear();
+        rebuild();
     }
     else
     {
         std::string key2 = key;
         boost::to_lower(key2);
+        tags_.erase(key2);
 
-        removeRow(key2);
+        std::string const id = rowId(key2);
+        if (id != key2)
+        {
+            // option row stays, value falls back to default
+            setRow(makeRow(options_[optionIndex_[id.substr(std::strlen(ModOptionsPrefix))]]));
+        }
+        else
+        {
+            removeRow(key2);
+        }
     }
 }
 
@@ -3,26 +3,40 @@
 #pragma once
 
 #include "StringTable.h"
+#include "model/GameInfo.h"
 
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 class Model;
 
+// shows all options of the game with name, default and description next to the values set by the host,
+// script tags not matching a game option are shown as is
 class GameSettings: public StringTable
 {
 public:
     GameSettings(int x, int y, int w, int h, Model & model);
 
+    void game(GameInfo const * gameInfo); // 0 if not known (yet), only script tags are shown then
+    void reset(); // removes all script tags and game options
+
 private:
     Model & model_;
-
-//    StringTableRow makeRow(User const & user);
-//    std::string statusString(User const & user);
+    std::vector<GameInfo::Option> options_;
+    std::map<std::string, std::size_t> optionIndex_; // lower case key -> options_ index
+    std::map<std::string, std::pair<std::string, std::string> > tags_; // lower case key -> key, value
 
     // StringTable signals
 //    void rowClicked(int rowIndex, int button);
 //    void rowDoubleClicked(int rowIndex, int button);
 
+    void rebuild();
+    std::string rowId(std::string const & key2) const; // key2 is lower case script tag key
+    StringTableRow makeRow(GameInfo::Option const & option);
+    void setRow(StringTableRow const & row);
+
     // model signals
     void setScriptTag(std::string const & key, std::string const & value); // e.g. GAME/StartMetal, 1000
     void removeScriptTag(std::string const & key);
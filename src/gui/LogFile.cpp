@@ -43,6 +43,18 @@ std::string LogFile::path()
     return dir() + name_ + ".log";
 }
 
+std::size_t LogFile::size()
+{
+    if (ofs_.is_open())
+    {
+        return static_cast<std::size_t>(ofs_.tellp());
+    }
+
+    boost::system::error_code ec;
+    std::size_t const size = boost::filesystem::file_size(path(), ec);
+    return ec ? 0 : size;
+}
+
 void LogFile::log(std::string const & text)
 {
     if (!enabled_) return;
@@ -17,6 +17,7 @@ public:
     static void enable(bool enable);
 
     std::string path();
+    std::size_t size(); // of file, lines written so far included
     void log(std::string const & text);
 
     static void openLogFile(std::string const& path);
@@ -0,0 +1,169 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "LogReader.h"
+#include "log/Log.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+LogReader::LogReader(std::string const & path):
+    path_(path),
+    fd_(-1),
+    data_(0),
+    mapSize_(0),
+    size_(0)
+{
+    fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0)
+    {
+        LOG(WARNING) << "failed to open " << path_ << ": " << std::strerror(errno);
+        throw std::runtime_error("failed to open log file: " + path_);
+    }
+
+    try
+    {
+        map();
+    }
+    catch (...)
+    {
+        ::close(fd_);
+        throw;
+    }
+}
+
+LogReader::~LogReader()
+{
+    unmap();
+    ::close(fd_);
+}
+
+void LogReader::update()
+{
+    map();
+}
+
+void LogReader::map()
+{
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+    {
+        throw std::runtime_error("log file stat failed: " + path_);
+    }
+
+    std::size_t const size = static_cast<std::size_t>(st.st_size);
+    if (size == mapSize_)
+    {
+        return;
+    }
+
+    unmap();
+    if (size > 0)
+    {
+        void * p = ::mmap(0, size, PROT_READ, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED)
+        {
+            throw std::runtime_error(std::string("log file mmap failed: ") + std::strerror(errno));
+        }
+        data_ = static_cast<char const *>(p);
+        mapSize_ = size;
+
+        // a line being written is not complete yet
+        void const * nl = ::memrchr(data_, '\n', mapSize_);
+        size_ = nl ? static_cast<char const *>(nl) - data_ + 1 : 0;
+    }
+}
+
+void LogReader::unmap()
+{
+    if (data_)
+    {
+        ::munmap(const_cast<char *>(data_), mapSize_);
+    }
+    data_ = 0;
+    mapSize_ = 0;
+    size_ = 0;
+}
+
+std::size_t LogReader::linesBefore(std::size_t end, std::size_t count, std::vector<Line> & lines) const
+{
+    std::size_t pos = std::min(end, size_);
+    if (pos > 0 && data_[pos-1] != '\n')
+    {
+        void const * nl = ::memrchr(data_, '\n', pos);
+        pos = nl ? static_cast<char const *>(nl) - data_ + 1 : 0;
+    }
+
+    std::size_t const first = lines.size();
+    for (std::size_t i = 0; i < count && pos > 0; ++i)
+    {
+        std::size_t const lineEnd = pos - 1; // newline
+        void const * nl = ::memrchr(data_, '\n', lineEnd);
+        std::size_t const lineBegin = nl ? static_cast<char const *>(nl) - data_ + 1 : 0;
+
+        Line line;
+        if (parse(data_ + lineBegin, data_ + lineEnd, line))
+        {
+            line.begin_ = lineBegin;
+            line.end_ = pos;
+            lines.push_back(line);
+        }
+        pos = lineBegin;
+    }
+    std::reverse(lines.begin() + first, lines.end());
+    return pos;
+}
+
+std::size_t LogReader::linesAfter(std::size_t begin, std::size_t count, std::vector<Line> & lines) const
+{
+    std::size_t pos = std::min(begin, size_);
+    if (pos > 0 && data_[pos-1] != '\n')
+    {
+        pos = static_cast<char const *>(::memchr(data_ + pos, '\n', size_ - pos)) - data_ + 1;
+    }
+
+    for (std::size_t i = 0; i < count && pos < size_; ++i)
+    {
+        std::size_t const lineEnd = static_cast<char const *>(::memchr(data_ + pos, '\n', size_ - pos)) - data_;
+
+        Line line;
+        if (parse(data_ + pos, data_ + lineEnd, line))
+        {
+            line.begin_ = pos;
+            line.end_ = lineEnd + 1;
+            lines.push_back(line);
+        }
+        pos = lineEnd + 1;
+    }
+    return pos;
+}
+
+bool LogReader::parse(char const * begin, char const * end, Line & line)
+{
+    // "YYYY-MM-DD HH:MM:SS: text", see LogFile::log
+    static char const format[] = "0000-00-00 00:00:00: ";
+    std::size_t const formatLength = sizeof(format) - 1;
+
+    if (static_cast<std::size_t>(end - begin) < formatLength)
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < formatLength; ++i)
+    {
+        bool const ok = (format[i] == '0') ? std::isdigit(static_cast<unsigned char>(begin[i])) : begin[i] == format[i];
+        if (!ok)
+        {
+            return false;
+        }
+    }
+
+    line.time_.assign(begin, formatLength - 2);
+    line.text_.assign(begin + formatLength, end);
+    return true;
+}
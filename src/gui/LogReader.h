@@ -0,0 +1,45 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read only view of a log file written by LogFile. The file is memory mapped and lines are found by
+// scanning for newlines from an offset, backwards for older lines, so reading a page of lines only
+// touches the pages around it however big the file is.
+class LogReader
+{
+public:
+    struct Line
+    {
+        std::size_t begin_; // offset in file
+        std::size_t end_; // offset after newline
+        std::string time_; // "YYYY-MM-DD HH:MM:SS"
+        std::string text_;
+    };
+
+    LogReader(std::string const & path); // throws on failure
+    virtual ~LogReader();
+
+    std::size_t size() const { return size_; } // of complete lines
+    void update(); // maps lines appended since
+
+    // scans count lines before end (or after begin), lines that are not log text are skipped
+    // returns offset of first (or after last) line scanned
+    std::size_t linesBefore(std::size_t end, std::size_t count, std::vector<Line> & lines) const; // oldest first
+    std::size_t linesAfter(std::size_t begin, std::size_t count, std::vector<Line> & lines) const;
+
+    static bool parse(char const * begin, char const * end, Line & line); // end excludes newline
+
+private:
+    std::string const path_;
+    int fd_;
+    char const * data_;
+    std::size_t mapSize_;
+    std::size_t size_;
+
+    void map();
+    void unmap();
+};
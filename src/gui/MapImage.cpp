@@ -4,6 +4,7 @@
 
 #include "FL/Fl.H"
 #include "FL/fl_draw.H"
+#include "FL/Fl_Shared_Image.H"
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 #include <algorithm>
@@ -11,12 +12,53 @@
 
 MapImage::MapImage(int X, int Y, int W, int H):
     Fl_Box(X, Y, W, H),
+    sharedImage_(0),
     ally_(-1)
 {
 }
 
 MapImage::~MapImage()
 {
+    if (sharedImage_)
+    {
+        sharedImage_->release();
+    }
+}
+
+void MapImage::setImage(Fl_Shared_Image* image)
+{
+    if (sharedImage_)
+    {
+        sharedImage_->release();
+    }
+    sharedImage_ = image;
+    Fl_Box::image(image);
+    redraw();
+}
+
+void MapImage::scrollImage(int dy, Fl_Shared_Image* const* images, int count)
+{
+    int const current = std::find(images, images + count, sharedImage_) - images;
+    int next = current;
+    if (current < count)
+    {
+        if (dy < 0 && current > 0) next = current - 1;
+        else if (dy > 0 && current < count - 1) next = current + 1;
+    }
+
+    for (int i=0; i<count; ++i)
+    {
+        if (images[i] == 0) continue;
+
+        if (i == next && next != current)
+        {
+            setImage(images[i]);
+        }
+        else
+        {
+            images[i]->release();
+        }
+    }
 }
 
 
@@ -6,6 +6,8 @@
 #include <FL/Fl_Box.H>
 #include <vector>
 
+class Fl_Shared_Image;
+
 class MapImage: public Fl_Box
 {
 public:
@@ -17,7 +19,12 @@ public:
     void removeAllStartRects();
     void setAlly(int ally);
 
+    // shared images are released when replaced, both methods take over the references passed in
+    void setImage(Fl_Shared_Image* image);
+    void scrollImage(int dy, Fl_Shared_Image* const* images, int count); // shows previous (dy<0) or next image in images
+
 private:
+    Fl_Shared_Image* sharedImage_;
     int ally_;
     std::vector<StartRect> startRects_;
 
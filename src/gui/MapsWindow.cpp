@@ -6,6 +6,7 @@
 #include "Cache.h"
 
 #include "model/Model.h"
+#include "log/Log.h"
 
 #include <FL/Fl.H>
 #include <FL/fl_draw.H>
@@ -13,9 +14,12 @@
 #include <FL/Fl_Box.H>
 #include <FL/Fl_Scrollbar.H>
 #include <FL/Fl_Tooltip.H>
+#include <FL/Fl_Input.H>
 
 #include <algorithm>
+#include <chrono>
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 
 static char const * PrefWindowX = "WindowX";
 static char const * PrefWindowY = "WindowY";
@@ -25,6 +29,11 @@ static char const * PrefWindowH = "WindowH";
 // Fl_Tooltip::margin_width/height() not available in FLTK 1.3.0
 static int const MARGIN = 3;
 
+static bool compareMapNames(std::string const& a, std::string const& b)
+{
+    return boost::ilexicographical_compare<std::string, std::string>(a, b);
+}
+
 MapsWindow::MapsWindow(Model & model, Cache& cache):
     Fl_Double_Window(100, 100, "Maps"),
     model_(model),
@@ -32,11 +41,20 @@ MapsWindow::MapsWindow(Model & model, Cache& cache):
     prefs_(prefs(), label())
 {
     int const scrollW = Fl::scrollbar_size();
-    mapArea_ = new MapArea(0, 0, w()-scrollW, h(), model);
-    scrollbar_ = new Fl_Scrollbar(w()-scrollW, 0, scrollW, h());
+    int const ih = FL_NORMAL_SIZE*2; // input height
+    filterInput_ = new Fl_Input(0, 0, w(), ih);
+    mapArea_ = new MapArea(0, ih, w()-scrollW, h()-ih, model, cache);
+    scrollbar_ = new Fl_Scrollbar(w()-scrollW, ih, scrollW, h()-ih);
     resizable(mapArea_);
     end();
 
+    filterInput_->when(FL_WHEN_CHANGED);
+    filterInput_->callback(&callbackFilter, this);
+    filterInput_->tooltip("Filter maps, e.g. 'dsd size:10-16 wind:15-'\n"
+                          "words match map name and author,\n"
+                          "ranges: size:, wind:, tidal:, gravity:, metal: (spots)\n"
+                          "a range is a-b, a-, -b or a");
+
     scrollbar_->callback(&callbackScrollbar, this);
     scrollbar_->linesize(MapArea::SIZE_);
 
@@ -46,11 +64,14 @@ MapsWindow::MapsWindow(Model & model, Cache& cache):
     prefs_.get(PrefWindowW, w, 600);
     prefs_.get(PrefWindowH, h, 600);
     resize(x,y,w,h);
-    size_range(MapArea::SIZE_ + scrollW, MapArea::SIZE_, 0, 0, 0, 0, 0);
+    size_range(MapArea::SIZE_ + scrollW, MapArea::SIZE_ + ih, 0, 0, 0, 0, 0);
+
+    cache_.connectMapInfoCached( boost::bind(&MapsWindow::mapInfoCached, this, _1) );
 }
 
 MapsWindow::~MapsWindow()
 {
+    Fl::remove_timeout(refilter, this);
     prefs_.set(PrefWindowX, x_root());
     prefs_.set(PrefWindowY, y_root());
     prefs_.set(PrefWindowW, w());
@@ -63,6 +84,52 @@ void MapsWindow::callbackScrollbar(Fl_Widget*, void *data)
     mw->onScrollbar();
 }
 
+void MapsWindow::callbackFilter(Fl_Widget*, void *data)
+{
+    MapsWindow* mw = static_cast<MapsWindow*>(data);
+    mw->applyFilter();
+}
+
+void MapsWindow::applyFilter()
+{
+    mapArea_->showMaps(filter_.filter(filterInput_->value()));
+    mapArea_->pos_ = 0;
+    updateScrollbar();
+}
+
+void MapsWindow::mapInfoCached(std::string const& mapName)
+{
+    // infos are cached by the map popup, battles and cache generation, maps without info fail range filters
+    auto const range = std::equal_range(filterNames_.begin(), filterNames_.end(), mapName, compareMapNames);
+    auto const it = std::find(range.first, range.second, mapName); // names may differ in case only
+    if (it == range.second)
+    {
+        return;
+    }
+    filter_.update(it - filterNames_.begin(), cache_.findMapInfo(mapName));
+
+    // cache generation stores many infos, scroll position is kept when matches did not change
+    if (shown() && !Fl::has_timeout(refilter, this))
+    {
+        Fl::add_timeout(0.5, refilter, this);
+    }
+}
+
+void MapsWindow::refilter(void* data)
+{
+    MapsWindow* mw = static_cast<MapsWindow*>(data);
+    if (mw->filter_.filter(mw->filterInput_->value()) != mw->mapArea_->shown_)
+    {
+        mw->applyFilter();
+    }
+}
+
+void MapsWindow::updateScrollbar()
+{
+    int const lines = mapArea_->lines()*MapArea::SIZE_;
+    scrollbar_->value(mapArea_->pos_, mapArea_->h(), 0, lines);
+}
+
 void MapsWindow::onScrollbar()
 {
     mapArea_->pos_ = scrollbar_->value();
@@ -74,29 +141,47 @@ int MapsWindow::handle(int event)
 {
     switch (event)
     {
-    case FL_SHOW: {
-        mapArea_->names_ = model_.getMaps();
-
-        auto comp=[](const std::string& a, const std::string& b){
-           return boost::ilexicographical_compare
-                               <std::string, std::string>(a,b);
-        };
+    case FL_SHOW:
+        loadMaps();
+        break;
 
-        std::sort(mapArea_->names_.begin(), mapArea_->names_.end(), comp);
+    case FL_HIDE:
+        mapArea_->releaseImages();
+        break;
 
-        mapArea_->images_.clear();
-        for (auto const& name : mapArea_->names_)
-        {
-            Fl_Shared_Image* im = cache_.getMapImage(name);
-            mapArea_->images_.push_back(im);
-        }
-        scrollbar_->value(0, mapArea_->h(), 0, mapArea_->lines()*MapArea::SIZE_);
+    }
 
-    } break;
+    return Fl_Double_Window::handle(event);
+}
 
+void MapsWindow::refresh()
+{
+    if (shown())
+    {
+        loadMaps();
     }
+}
 
-    return Fl_Double_Window::handle(event);
+void MapsWindow::loadMaps()
+{
+    std::vector<std::string> names = model_.getMaps();
+
+    std::sort(names.begin(), names.end(), compareMapNames);
+
+    // images are loaded when drawn
+    mapArea_->setMaps(names);
+
+    // filter index of cached map infos, rebuilt only when maps changed
+    if (filter_.size() != names.size() || names != filterNames_)
+    {
+        filter_.clear();
+        for (auto const& name : names)
+        {
+            filter_.add(name, cache_.findMapInfo(name));
+        }
+        filterNames_ = names;
+    }
+    applyFilter();
 }
 
 void MapsWindow::draw()
@@ -108,8 +193,8 @@ void MapsWindow::draw()
 void MapsWindow::resize(int x, int y, int w, int h)
 {
     Fl_Double_Window::resize(x, y, w, h);
-    int const lines = mapArea_->lines()*MapArea::SIZE_;
-    scrollbar_->value(0, mapArea_->h(), 0, lines);
+    mapArea_->pos_ = 0;
+    updateScrollbar();
     onScrollbar();
 }
 
@@ -150,10 +235,14 @@ void MapsWindow::MapArea::MapInfoWin::draw()
 ////////////
 // MapArea
 
-MapsWindow::MapArea::MapArea(int x, int y, int w, int h, Model& model)
+MapsWindow::MapArea::MapArea(int x, int y, int w, int h, Model& model, Cache& cache)
     : Fl_Widget(x, y, w, h)
+    , drawCount_(0)
+    , loaded_(0)
+    , loading_(false)
     , pos_(0)
     , model_(model)
+    , cache_(cache)
 {
     Fl_Group *save = Fl_Group::current();
     mapInfoWin_ = new MapInfoWin();
@@ -161,18 +250,72 @@ MapsWindow::MapArea::MapArea(int x, int y, int w, int h, Model& model)
     Fl_Group::current(save);
 }
 
+MapsWindow::MapArea::~MapArea()
+{
+    releaseImages();
+}
+
+void MapsWindow::MapArea::setMaps(std::vector<std::string> const& names)
+{
+    releaseImages();
+    names_ = names;
+    shown_.resize(names_.size());
+    for (int i=0; i<shown_.size(); ++i)
+    {
+        shown_[i] = i;
+    }
+    images_.assign(names_.size(), 0);
+    used_.assign(names_.size(), 0);
+    failed_.assign(names_.size(), false);
+    redraw();
+}
+
+void MapsWindow::MapArea::showMaps(std::vector<int> const& indexes)
+{
+    // loaded images are kept, the filter is often changed back and forth
+    shown_ = indexes;
+    pending_.clear();
+    redraw();
+}
+
+void MapsWindow::MapArea::releaseImages()
+{
+    Fl::remove_timeout(loadImages, this);
+    loading_ = false;
+    pending_.clear();
+
+    for (auto& im : images_)
+    {
+        if (im)
+        {
+            im->release();
+            im = 0;
+        }
+    }
+    loaded_ = 0;
+}
+
 void MapsWindow::MapArea::draw()
 {
+    // x and y below are relative to the widget, the filter input is above it
+    int const X = this->x();
+    int const Y = this->y();
+    fl_push_clip(X, Y, w(), h());
     fl_color(FL_BACKGROUND_COLOR);
-    fl_rectf(0, 0, w(), h());
+    fl_rectf(X, Y, w(), h());
 
+    ++drawCount_;
+
+    int const perLine = mapsPerLine();
     int line = pos_/SIZE_;
-    int first = line*mapsPerLine();
+    int first = line*perLine;
+    int last = first; // one past last visible
 
     int x = 0;
     int y = line*SIZE_ - pos_;
-    for (int i=first; i<images_.size(); ++i)
+    for (int n=first; n<shown_.size(); ++n)
     {
+        int const i = shown_[n];
         auto im = images_[i];
         if (x > (w()-SIZE_) && x != 0)
         {
@@ -184,9 +327,135 @@ void MapsWindow::MapArea::draw()
             break;
 
         if (im)
-            im->draw(x + SIZE_/2 - im->w()/2, y + SIZE_/2 - im->h()/2);
+        {
+            im->draw(X + x + SIZE_/2 - im->w()/2, Y + y + SIZE_/2 - im->h()/2);
+            used_[i] = drawCount_;
+        }
+        else if (!failed_[i])
+        {
+            // placeholder until loaded
+            fl_color(FL_DARK1);
+            fl_rect(X + x + 1, Y + y + 1, SIZE_ - 2, SIZE_ - 2);
+        }
 
         x += SIZE_;
+        last = n + 1;
+    }
+    fl_pop_clip();
+
+    requestImages(first, last, perLine);
+}
+
+void MapsWindow::MapArea::requestImages(int first, int last, int perLine)
+{
+    // visible maps first, then the lines just below and above, first and last are positions in shown_
+    pending_.clear();
+    int const size = shown_.size();
+    auto request = [this](int n)
+    {
+        int const i = shown_[n];
+        if (!images_[i] && !failed_[i]) pending_.push_back(i);
+    };
+    for (int n=first; n<last; ++n)
+    {
+        request(n);
+    }
+    for (int n=last; n<std::min(last+perLine, size); ++n)
+    {
+        request(n);
+    }
+    for (int n=std::max(first-perLine, 0); n<first; ++n)
+    {
+        request(n);
+    }
+
+    if (!pending_.empty() && !loading_)
+    {
+        Fl::add_timeout(0, loadImages, this);
+        loading_ = true;
+    }
+}
+
+void MapsWindow::MapArea::loadImages(void* data)
+{
+    static_cast<MapArea*>(data)->loadPending();
+}
+
+void MapsWindow::MapArea::loadPending()
+{
+    // load for a short time per timeout to keep the ui responsive,
+    // an image not in the cache is generated by unitsync which can take a while
+    typedef std::chrono::steady_clock Clock;
+    auto const start = Clock::now();
+    auto const budget = std::chrono::milliseconds(20);
+
+    loading_ = false;
+    bool loadedAny = false;
+    while (!pending_.empty() && Clock::now() - start < budget)
+    {
+        int const i = pending_.front();
+        pending_.pop_front();
+        if (images_[i] || failed_[i]) continue;
+
+        try
+        {
+            images_[i] = cache_.getMapImage(names_[i]);
+        }
+        catch (std::exception const& e)
+        {
+            LOG(WARNING) << e.what();
+        }
+
+        if (images_[i])
+        {
+            used_[i] = drawCount_;
+            ++loaded_;
+        }
+        else
+        {
+            failed_[i] = true;
+        }
+        loadedAny = true;
+    }
+
+    if (loadedAny)
+    {
+        evictImages();
+        redraw(); // requests remaining images
+    }
+    else if (!pending_.empty())
+    {
+        Fl::add_timeout(0, loadImages, this);
+        loading_ = true;
+    }
+}
+
+void MapsWindow::MapArea::evictImages()
+{
+    if (loaded_ <= MAX_IMAGES_)
+    {
+        return;
+    }
+
+    // release least recently drawn images, visible ones are never released
+    std::vector<int> candidates;
+    for (int i=0; i<images_.size(); ++i)
+    {
+        if (images_[i] && used_[i] != drawCount_)
+        {
+            candidates.push_back(i);
+        }
+    }
+
+    std::size_t const count = std::min<std::size_t>(loaded_ - MAX_IMAGES_, candidates.size());
+    std::nth_element(candidates.begin(), candidates.begin() + count, candidates.end(),
+                     [this](int a, int b) { return used_[a] < used_[b]; });
+    for (std::size_t n=0; n<count; ++n)
+    {
+        int const i = candidates[n];
+        images_[i]->release();
+        images_[i] = 0;
+        --loaded_;
     }
 }
 
@@ -216,10 +485,10 @@ int MapsWindow::MapArea::mousePosToMapIndex(int x, int y)
     int offsetX = x/SIZE_; // offsetX is map index on line
     if (offsetX < mapsPerLine())
     {
-        int index = mapsPerLine()*((pos_ + y)/SIZE_) + offsetX;
-        if (index < names_.size())
+        int n = mapsPerLine()*((pos_ + y - this->y())/SIZE_) + offsetX;
+        if (n < shown_.size())
         {
-            return index;
+            return shown_[n];
         }
     }
     return -1;
@@ -245,13 +514,14 @@ void MapsWindow::MapArea::showMapInfoMenu(int x, int y)
     if (index >= 0)
     {
         PopupMenu menu;
-        MapInfo mi = model_.getMapInfo(names_[index]);
+        MapInfo const& mi = cache_.getMapInfo(names_[index]);
         std::ostringstream oss;
         oss << mi.name_ << ": "
             << "Size:" << mi.width_/512 << "x" << mi.height_/512 << ", "
             << "Wind:" << mi.windMin_ << "-" << mi.windMax_ << ", "
             << "Tidal:" << mi.tidalStrength_ << ", "
-            << "Gravity:" << mi.gravity_;
+            << "Gravity:" << mi.gravity_ << ", "
+            << "Metal spots:" << mi.metalSpots_.size();
         menu.add(oss.str());
         menu.add("Copy map name to clipboard", 1);
         int const id = menu.show();
@@ -277,6 +547,6 @@ int MapsWindow::MapArea::linesVisible() const
 
 int MapsWindow::MapArea::lines() const
 {
-    int const lines = 1 + names_.size()/mapsPerLine();
+    int const lines = 1 + shown_.size()/mapsPerLine();
     return lines;
 }
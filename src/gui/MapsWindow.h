@@ -6,6 +6,9 @@
 #include <FL/Fl_Preferences.H>
 #include <FL/Fl_Menu_Window.H>
 
+#include "model/MapFilter.h"
+
+#include <deque>
 #include <vector>
 #include <string>
 
@@ -15,6 +18,7 @@ class Cache;
 class Fl_Shared_Image;
 class Fl_Box;
 class Fl_Scrollbar;
+class Fl_Input;
 
 class MapsWindow: public Fl_Double_Window
 {
@@ -22,6 +26,8 @@ public:
     MapsWindow(Model & model, Cache& cache);
     virtual ~MapsWindow();
 
+    void refresh(); // reloads map list if shown
+
 private:
     Model& model_;
     Cache& cache_;
@@ -39,19 +45,39 @@ private:
             std::string info_;
         };
 
+        // images are loaded on demand for the visible maps (and one line around them),
+        // off-screen images are released when more than MAX_IMAGES_ are loaded
         std::vector<std::string> names_;
-        std::vector<Fl_Shared_Image*> images_;
+        std::vector<int> shown_; // indexes of maps passing the filter, in display order
+        std::vector<Fl_Shared_Image*> images_; // 0 if not loaded
+        std::vector<unsigned int> used_; // drawCount_ when image was last drawn
+        std::vector<bool> failed_;
+        std::deque<int> pending_; // indexes to load, in priority order
+        unsigned int drawCount_;
+        int loaded_;
+        bool loading_; // load timeout active
         static const int SIZE_ = 128+2;
+        static const int MAX_IMAGES_ = 300;
         int pos_;
 
         MapArea::MapInfoWin* mapInfoWin_;
         Model& model_;
+        Cache& cache_;
 
-        MapArea(int x, int y, int w, int h, Model& model);
+        MapArea(int x, int y, int w, int h, Model& model, Cache& cache);
+        ~MapArea();
         void draw();
         int handle(int event);
 
-        int mousePosToMapIndex(int x, int y); // returns -1 if not on a map
+        void setMaps(std::vector<std::string> const& names);
+        void showMaps(std::vector<int> const& indexes);
+        void releaseImages();
+        void requestImages(int first, int last, int perLine);
+        static void loadImages(void* data);
+        void loadPending();
+        void evictImages();
+
+        int mousePosToMapIndex(int x, int y); // returns index in names_, -1 if not on a map
         void updateMapInfoWin(int x, int y);
         void showMapInfoMenu(int x, int y);
         int mapsPerLine() const;
@@ -60,9 +86,18 @@ private:
     };
     MapArea* mapArea_;
     Fl_Scrollbar* scrollbar_;
+    Fl_Input* filterInput_;
+    MapFilter filter_;
+    std::vector<std::string> filterNames_; // maps in filter_
 
     static void callbackScrollbar(Fl_Widget*, void*);
     void onScrollbar();
+    static void callbackFilter(Fl_Widget*, void*);
+    void applyFilter();
+    void mapInfoCached(std::string const& mapName);
+    static void refilter(void* data);
+    void updateScrollbar();
+    void loadMaps();
     int handle(int event);
     void draw();
     void resize(int x, int y, int w, int h);
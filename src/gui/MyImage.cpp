@@ -5,14 +5,17 @@
 #include "log/Log.h"
 
 #include <FL/Fl_Shared_Image.H>
+#include <cstdio> // rename
+#include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <sstream>
 #include <stdexcept>
 
 MyImage::MyImage(std::string const & fileName):
     Fl_RGB_Image(0,0,0)
 {
-    std::ifstream ifs(fileName);
+    std::ifstream ifs(fileName, std::ios::binary);
 
     if (!ifs.good())
     {
@@ -86,9 +89,17 @@ void MyImage::registerHandler()
 
 Fl_Image * MyImage::check(char const * fileName, uchar * header, int headerSize)
 {
-    if (::memcmp(header, "FLOBBY_IMAGE", 12) == 0)
+    if (headerSize >= 12 && ::memcmp(header, "FLOBBY_IMAGE", 12) == 0)
     {
-        return new MyImage(fileName);
+        // exceptions must not pass through fltk
+        try
+        {
+            return new MyImage(fileName);
+        }
+        catch (std::exception const & e)
+        {
+            LOG(WARNING) << "failed to load " << fileName << ": " << e.what();
+        }
     }
 
     return 0;
@@ -97,12 +108,7 @@ Fl_Image * MyImage::check(char const * fileName, uchar * header, int headerSize)
 void MyImage::write(std::string const & path, uchar const * mapImageData, int w, int h, int d)
 {
     LOG(DEBUG) << "write " << path;
-    std::ofstream ofs(path);
 
-    if (!ofs.good())
-    {
-        throw std::runtime_error("failed to create image file:" + path);
-    }
     // sanity check dimension
     if (w < 1 || w > 2048 ||
         h < 1 || h > 2048 ||
@@ -111,12 +117,67 @@ void MyImage::write(std::string const & path, uchar const * mapImageData, int w,
         throw std::runtime_error("bad dimensions");
     }
 
-    ofs << "FLOBBY_IMAGE"
+    // write to temporary file and rename it to never leave a partial image file
+    std::string const tmpPath = path + ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ios::binary);
+
+        if (!ofs.good())
+        {
+            throw std::runtime_error("failed to create image file:" + tmpPath);
+        }
+
+        ofs << header(w, h, d);
+
+        ofs.write(reinterpret_cast<char const *>(mapImageData), w*h*d);
+
+        if (!ofs.good())
+        {
+            throw std::runtime_error("failed to write image file:" + tmpPath);
+        }
+    }
+
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("failed to rename image file:" + tmpPath);
+    }
+}
+
+
+std::string MyImage::header(int w, int h, int d)
+{
+    std::ostringstream oss;
+    oss << "FLOBBY_IMAGE"
         << " " << w
         << " " << h
         << " " << d
         << '\n';
-
-    ofs.write(reinterpret_cast<char const *>(mapImageData), w*h*d);
+    return oss.str();
 }
 
+std::size_t MyImage::parseHeader(uchar const * data, std::size_t size, int & w, int & h, int & d)
+{
+    // header is short, find the terminating newline and parse it as the file header
+    std::size_t const maxHeaderSize = 64;
+    uchar const * end = static_cast<uchar const *>(::memchr(data, '\n', std::min(size, maxHeaderSize)));
+    if (end == 0)
+    {
+        return 0;
+    }
+
+    std::istringstream iss(std::string(reinterpret_cast<char const *>(data), end - data));
+    std::string id;
+    iss >> id >> w >> h >> d;
+    if (iss.fail() || id != "FLOBBY_IMAGE" || w < 1 || h < 1 || d < 1 || d > 3)
+    {
+        return 0;
+    }
+
+    std::size_t const headerSize = end - data + 1;
+    if (size - headerSize != static_cast<std::size_t>(w)*h*d)
+    {
+        return 0;
+    }
+    return headerSize;
+}
@@ -15,6 +15,10 @@ public:
     static void registerHandler();
     static void write(std::string const & path, uchar const * mapImageData, int w, int h, int d);
 
+    // header for in memory images, e.g. images stored in a PackFile
+    static std::string header(int w, int h, int d);
+    static std::size_t parseHeader(uchar const * data, std::size_t size, int & w, int & h, int & d); // returns header size, 0 on error
+
 private:
     static Fl_Image * check(char const * fileName, uchar * header, int headerSize);
 
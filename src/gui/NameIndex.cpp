@@ -0,0 +1,117 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "NameIndex.h"
+
+#include <algorithm>
+#include <cctype>
+
+NameIndex::NameIndex():
+    sorted_(true)
+{
+}
+
+std::string NameIndex::fold(std::string const & str)
+{
+    std::string res(str);
+    for (char & c : res)
+    {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return res;
+}
+
+void NameIndex::add(std::string const & name)
+{
+    Entry const entry = { fold(name), name };
+    if (sorted_)
+    {
+        entries_.insert(std::lower_bound(entries_.begin(), entries_.end(), entry), entry);
+    }
+    else
+    {
+        entries_.push_back(entry);
+    }
+}
+
+void NameIndex::addUnsorted(std::string const & name)
+{
+    entries_.push_back(Entry { fold(name), name });
+    sorted_ = false;
+}
+
+void NameIndex::remove(std::string const & name)
+{
+    sort();
+    Entry const entry = { fold(name), name };
+    auto const it = std::lower_bound(entries_.begin(), entries_.end(), entry);
+    if (it != entries_.end() && it->name_ == name)
+    {
+        entries_.erase(it);
+    }
+}
+
+void NameIndex::clear()
+{
+    entries_.clear();
+    sorted_ = true;
+}
+
+void NameIndex::sort()
+{
+    if (!sorted_)
+    {
+        std::sort(entries_.begin(), entries_.end());
+        sorted_ = true;
+    }
+}
+
+std::string NameIndex::complete(std::string const & text, std::string const & previousMatch)
+{
+    if (text.empty())
+    {
+        return std::string();
+    }
+    sort();
+
+    std::string const key = fold(text);
+
+    // names starting with text, keys with the prefix are a range in sort order
+    auto const begin = std::lower_bound(entries_.begin(), entries_.end(), key,
+                                        [](Entry const & e, std::string const & k) { return e.key_ < k; });
+    auto end = begin;
+    while (end != entries_.end() && end->key_.compare(0, key.size(), key) == 0)
+    {
+        ++end;
+    }
+
+    // then names containing text
+    std::vector<Entry const *> matches;
+    for (auto it = begin; it != end; ++it)
+    {
+        matches.push_back(&*it);
+    }
+    for (auto it = entries_.begin(); it != entries_.end(); ++it)
+    {
+        if ((it < begin || it >= end) && it->key_.find(key) != std::string::npos)
+        {
+            matches.push_back(&*it);
+        }
+    }
+
+    if (matches.empty())
+    {
+        return std::string();
+    }
+    if (previousMatch.empty())
+    {
+        return matches.front()->name_;
+    }
+
+    auto const prev = std::find_if(matches.begin(), matches.end(),
+                                   [&previousMatch](Entry const * e) { return e->name_ == previousMatch; });
+    if (prev == matches.end())
+    {
+        return std::string();
+    }
+    return (prev + 1 == matches.end()) ? matches.front()->name_ : (*(prev + 1))->name_;
+}
@@ -0,0 +1,37 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Case insensitive index of names for tab completion, names starting with the completed text are found
+// with binary search and come first, then names containing it. Both in case insensitive order.
+class NameIndex
+{
+public:
+    NameIndex();
+
+    void add(std::string const & name); // sorted insert
+    void addUnsorted(std::string const & name); // for filling, sorted when next needed
+    void remove(std::string const & name);
+    void clear();
+    std::size_t size() const { return entries_.size(); }
+
+    // returns first match or match after previousMatch (wraps), empty if no match
+    // or if previousMatch is not a match
+    std::string complete(std::string const & text, std::string const & previousMatch = "");
+
+private:
+    struct Entry
+    {
+        std::string key_; // upper case name
+        std::string name_;
+        bool operator<(Entry const & e) const { return key_ < e.key_ || (key_ == e.key_ && name_ < e.name_); }
+    };
+    std::vector<Entry> entries_; // sorted when sorted_
+    bool sorted_; // false after addUnsorted so filling a list is not quadratic
+
+    static std::string fold(std::string const & str);
+    void sort();
+};
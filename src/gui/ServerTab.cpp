@@ -60,6 +60,7 @@ ServerTab::ServerTab(int x, int y, int w, int h,
     model_.connectServerMsg( boost::bind(&ServerTab::message, this, _1, _2) );
     model_.connectUserJoined( boost::bind(&ServerTab::userJoined, this, _1) );
     model_.connectUserLeft( boost::bind(&ServerTab::userLeft, this, _1) );
+    model_.connectUserChanged( boost::bind(&UserList::userChanged, userList_, _1) ); // all users
     model_.connectRing( boost::bind(&ServerTab::ring, this, _1) );
     model_.connectDownloadDone( boost::bind(&ServerTab::downloadDone, this, _1, _2, _3) );
 }
@@ -118,6 +119,7 @@ void ServerTab::loginResult(bool success, std::string const & info)
     {
         std::vector<User const *> users = model_.getUsers();
 
+        StringTable::Update update(*userList_);
         for (auto u : users)
         {
             assert(u);
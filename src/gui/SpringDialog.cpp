@@ -7,17 +7,24 @@
 
 #include <FL/Fl_Hold_Browser.H>
 #include <FL/Fl_File_Input.H>
+#include <FL/Fl_Int_Input.H>
 #include <FL/Fl_Return_Button.H>
 #include <FL/Fl_Native_File_Chooser.H>
 #include <FL/fl_ask.H>
 #include <boost/filesystem.hpp>
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <string>
 
 // prefs
 char const * const PrefSpringProfile = "SpringProfile";
 char const * const PrefSpringPath = "SpringPath";
 char const * const PrefSpringOptions = "SpringOptions";
 char const * const PrefUnitSyncPath = "UnitSyncPath";
+char const * const PrefUnitSyncPoolSize = "UnitSyncPoolSize";
+
+int const maxUnitSyncPoolSize = 8; // as in the label, Model has the same limit
 
 SpringDialog::SpringDialog(Model & model) :
         model_(model), prefs_(prefs(), "SpringProfiles"), Fl_Window(800, 600,
@@ -49,6 +56,11 @@ SpringDialog::SpringDialog(Model & model) :
     btn = new Fl_Button(770, 230, 20, 40, "...");
     btn->callback(SpringDialog::callbackBrowseUnitSync, this);
 
+    unitSyncPoolSize_ = new Fl_Int_Input(220, 520, 100, 30, "Engines kept loaded for quick switching (0-8)");
+    unitSyncPoolSize_->align(FL_ALIGN_TOP_LEFT);
+    unitSyncPoolSize_->when(FL_WHEN_CHANGED);
+    unitSyncPoolSize_->callback(SpringDialog::callbackUnitSyncPoolSize, this);
+
     save_ = new Fl_Button(700, 460, 90, 30, "Save");
     save_->callback(SpringDialog::callbackSave, this);
 
@@ -63,6 +75,12 @@ SpringDialog::SpringDialog(Model & model) :
     select_->deactivate();
 
     end();
+
+    int poolSize;
+    prefs().get(PrefUnitSyncPoolSize, poolSize, 2);
+    poolSize = std::min(std::max(poolSize, 0), maxUnitSyncPoolSize);
+    unitSyncPoolSize_->value(std::to_string(poolSize).c_str());
+    model_.unitSyncPoolSize(poolSize);
 }
 
 SpringDialog::~SpringDialog()
@@ -360,6 +378,27 @@ void SpringDialog::callbackBrowseUnitSync(Fl_Widget*, void *data)
     o->onBrowseUnitSync();
 }
 
+void SpringDialog::callbackUnitSyncPoolSize(Fl_Widget*, void *data)
+{
+    SpringDialog * o = static_cast<SpringDialog*>(data);
+    o->onUnitSyncPoolSize();
+}
+
+void SpringDialog::onUnitSyncPoolSize()
+{
+    int poolSize = std::atoi(unitSyncPoolSize_->value());
+    if (poolSize >= 0)
+    {
+        if (poolSize > maxUnitSyncPoolSize)
+        {
+            poolSize = maxUnitSyncPoolSize;
+            unitSyncPoolSize_->value(std::to_string(poolSize).c_str());
+        }
+        prefs().set(PrefUnitSyncPoolSize, poolSize);
+        model_.unitSyncPoolSize(poolSize);
+    }
+}
+
 void SpringDialog::onList()
 {
     int const line = list_->value();
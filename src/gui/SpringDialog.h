@@ -12,6 +12,7 @@ class Model;
 class Fl_Hold_Browser;
 class Fl_Input;
 class Fl_File_Input;
+class Fl_Int_Input;
 class Fl_Button;
 class Fl_Return_Button;
 
@@ -46,6 +47,7 @@ private:
     Fl_File_Input * springPath_;
     Fl_Input * springOptions_;
     Fl_File_Input * unitSyncPath_;
+    Fl_Int_Input * unitSyncPoolSize_;
     Fl_Button * save_;
     Fl_Button * delete_;
     Fl_Button * add_;
@@ -58,6 +60,7 @@ private:
     static void callbackSelect(Fl_Widget*, void*);
     static void callbackBrowseSpring(Fl_Widget*, void*);
     static void callbackBrowseUnitSync(Fl_Widget*, void*);
+    static void callbackUnitSyncPoolSize(Fl_Widget*, void*);
 
     void initList(bool selectCurrent = false);
     void clearInputFields();
@@ -69,6 +72,7 @@ private:
     void onSelect();
     void onBrowseSpring();
     void onBrowseUnitSync();
+    void onUnitSyncPoolSize();
     bool openFileDialog(char const * title, char const * fileName, std::string & result); // returns false on cancel
     boost::filesystem::path findEngineDir(boost::filesystem::path const& engineDir, std::string const& engineVersion);
     std::string buildSpringCmd(Fl_Preferences& profile);
@@ -11,6 +11,9 @@
 #include <boost/algorithm/string.hpp>
 #include <algorithm>            // STL sort
 #include <cassert>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
 #include <stdexcept>
 
 // Prefs
@@ -26,7 +29,9 @@ StringTable::StringTable(int x, int y, int w, int h, std::string const & name,
     selectedRow_(-1),
     headers_(headers),
     prefs_(prefs(), label()),
-    savePrefs_(savePrefs)
+    savePrefs_(savePrefs),
+    source_(0),
+    updateDepth_(0)
 {
     labeltype(FL_NO_LABEL);
     box(FL_THIN_DOWN_FRAME);
@@ -88,13 +93,28 @@ void StringTable::sort()
 // Sort a column up or down
 void StringTable::sort_column(int col, int reverse)
 {
+    if (updating())
+    {
+        return; // sorted in endUpdate
+    }
+
+    if (source_ && col != sort_lastcol_)
+    {
+        // only keys of the sort column are kept
+        for (auto & row : rows_)
+        {
+            row.sortKeys_[0] = sourceSortKey(row.id_, col);
+        }
+    }
+
     std::string id;
     if (selectedRow_ != -1)
     {
         assert(selectedRow_ >= 0 && selectedRow_ < rows());
         id = rows_[selectedRow_].id_;
     }
-    std::stable_sort(rows_.begin(), rows_.end(), SortColumn(col, reverse));
+    std::stable_sort(rows_.begin(), rows_.end(), SortColumn(keyIndex(col), reverse));
+    reindex(0);
 
     if (!id.empty())
     {
@@ -150,11 +170,17 @@ void StringTable::draw_cell(TableContext context, int R, int C, int X, int Y, in
         }
         return;
 
+        case CONTEXT_STARTPAGE:
+            pruneCellCache();
+            return;
+
         case CONTEXT_CELL:
         {
             fl_push_clip(X,Y,W,H);
             if ( C < headers_.size() && R < static_cast<int>(rows_.size()) )
             {
+                std::vector<std::string> const & cells = getCells(R);
+
                 // Bg color
                 Fl_Color bgcolor = (selectedRow_ == R) ? selection_color() : FL_BACKGROUND2_COLOR;
                 fl_color(bgcolor); fl_rectf(X,Y,W,H); 
@@ -162,14 +188,14 @@ void StringTable::draw_cell(TableContext context, int R, int C, int X, int Y, in
                 // text or color
                 if (headers_[C].name_ == "color")
                 {
-                    fl_color(fltkColor(rows_[R].data_[C]));
+                    fl_color(fltkColor(cells[C]));
                     fl_rectf(X+2, Y+2, W-4, H-4);
                 }
                 else
                 {
                     fl_font(FL_HELVETICA, FL_NORMAL_SIZE);
                     fl_color(active_r() ? FL_FOREGROUND_COLOR : FL_INACTIVE_COLOR);
-                    fl_draw(rows_[R].data_[C].c_str(), X+2,Y,W,H, FL_ALIGN_LEFT); // +2=pad left
+                    fl_draw(cells[C].c_str(), X+2,Y,W,H, FL_ALIGN_LEFT); // +2=pad left
                 }
 
                 // line below
@@ -209,93 +235,411 @@ StringTableRow const & StringTable::getRow(std::size_t rowIndex)
 
 void StringTable::addRow(const StringTableRow & row)
 {
+    assert(!source_);
     assert(row.data_.size() == headers_.size());
 
-    // check row does not exist
-    for (StringTableRow const & r : rows_)
+    if (index_.count(row.id_) > 0)
     {
-        if (row.id_ == r.id_)
-        {
-            throw std::runtime_error("row already exist: " + row.id_);
-        }
+        throw std::runtime_error("row already exist: " + row.id_);
+    }
+
+    StringTableRow keyed(row);
+    setSortKeys(keyed, 0);
+    addKeyed(keyed);
+}
+
+void StringTable::addRow(std::string const & id)
+{
+    assert(source_);
+
+    if (index_.count(id) > 0)
+    {
+        throw std::runtime_error("row already exist: " + id);
+    }
+
+    // cells are formatted when drawn
+    StringTableRow keyed(id, {});
+    keyed.sortKeys_.push_back(sortKey(source_->cell(id, sort_lastcol_), headers_[sort_lastcol_].sortKind_));
+    addKeyed(keyed);
+}
+
+void StringTable::addKeyed(StringTableRow & row)
+{
+    if (updating())
+    {
+        // sorted in endUpdate
+        index_[row.id_] = rows_.size();
+        rows_.push_back(std::move(row));
+        return;
     }
 
-    rows_.push_back(row);
+    // sorted insert, after equal rows like the stable sort done on all rows
+    insertAt(insertPosition(row), row);
     rows( static_cast<int>(rows_.size()) );
     row_height(rows()-1, col_header_height()+2);
-
-    // instant sort
-    sort();
+    redraw();
 }
 
 void StringTable::updateRow(const StringTableRow & row)
 {
-    int i = 0;
-    for (StringTableRow & r : rows_)
+    assert(!source_);
+
+    auto const it = index_.find(row.id_);
+    if (it == index_.end())
     {
-        if (row.id_ == r.id_)
-        {
-            // only redraw if content changed
-            if (r.data_ != row.data_)
-            {
-                r.data_ = row.data_;
+        throw std::runtime_error("row not found:" + row.id_);
+    }
+    StringTableRow const & r = rows_[it->second];
 
-                // instant sort
-                sort();
-            }
+    // only redraw if content changed
+    if (r.data_ == row.data_)
+    {
+        return;
+    }
+
+    StringTableRow keyed(row);
+    setSortKeys(keyed, &r);
+    updateKeyed(it->second, keyed);
+}
+
+void StringTable::updateRow(std::string const & id)
+{
+    assert(source_);
+
+    auto const it = index_.find(id);
+    if (it == index_.end())
+    {
+        throw std::runtime_error("row not found:" + id);
+    }
+
+    // only visible rows are cached, only redraw if their content changed, other rows only need their sort key
+    std::string key;
+    auto const cached = cellCache_.find(id);
+    if (cached != cellCache_.end())
+    {
+        std::vector<std::string> cells = source_->cells(id);
+        assert(cells.size() == headers_.size());
+        if (cached->second == cells)
+        {
             return;
         }
-        ++i;
+        key = cells[sort_lastcol_];
+        cached->second = std::move(cells);
+    }
+    else
+    {
+        key = source_->cell(id, sort_lastcol_);
+    }
+
+    StringTableRow keyed(id, {});
+    keyed.sortKeys_.push_back(sortKey(key, headers_[sort_lastcol_].sortKind_));
+    updateKeyed(it->second, keyed);
+}
+
+void StringTable::updateKeyed(std::size_t pos, StringTableRow & row)
+{
+    StringTableRow & r = rows_[pos];
+
+    if (updating())
+    {
+        r = std::move(row);
+        return;
+    }
+
+    int const k = keyIndex(sort_lastcol_);
+    if (row.sortKeys_[k] == r.sortKeys_[k])
+    {
+        // position unchanged
+        r = std::move(row);
+        redraw_range(static_cast<int>(pos), static_cast<int>(pos), 0, cols()-1);
+        return;
+    }
+
+    // move to new position
+    bool const selected = (selectedRow_ == static_cast<int>(pos));
+    eraseAt(pos);
+    std::size_t const newPos = insertPosition(row);
+    insertAt(newPos, row);
+    if (selected)
+    {
+        selectedRow_ = static_cast<int>(newPos);
+    }
+    redraw();
+}
+
+std::vector<std::string> const & StringTable::getCells(std::size_t rowIndex)
+{
+    StringTableRow const & row = getRow(rowIndex);
+    if (!source_)
+    {
+        return row.data_;
+    }
+
+    auto const it = cellCache_.find(row.id_);
+    if (it != cellCache_.end())
+    {
+        return it->second;
+    }
+
+    std::vector<std::string> cells;
+    try
+    {
+        cells = source_->cells(row.id_);
+    }
+    catch (std::exception const & e)
+    {
+        LOG(WARNING) << "no cells for row " << row.id_ << ": " << e.what();
+    }
+    cells.resize(headers_.size());
+
+    std::vector<std::string> & cached = cellCache_[row.id_];
+    cached = std::move(cells);
+    return cached;
+}
+
+std::string StringTable::sourceSortKey(std::string const & id, int col)
+{
+    try
+    {
+        return sortKey(source_->cell(id, col), headers_[col].sortKind_);
+    }
+    catch (std::exception const & e)
+    {
+        LOG(WARNING) << "no cells for row " << id << ": " << e.what();
+        return std::string();
+    }
+}
+
+void StringTable::pruneCellCache()
+{
+    for (auto it = cellCache_.begin(); it != cellCache_.end(); )
+    {
+        auto const pos = index_.find(it->first);
+        if (pos == index_.end() || static_cast<int>(pos->second) < toprow || static_cast<int>(pos->second) > botrow)
+        {
+            it = cellCache_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
     }
+}
 
-    // only reached if row not found
-    throw std::runtime_error("row not found:" + row.id_);
+void StringTable::setSource(StringTableSource * source)
+{
+    assert(rows_.empty());
+    source_ = source;
+    cellCache_.clear();
 }
 
 void StringTable::removeRow(std::string const & id)
 {
-    int row = 0;
-    for (std::vector<StringTableRow>::iterator it = rows_.begin(); it != rows_.end(); ++it)
+    auto const it = index_.find(id);
+    if (it == index_.end())
     {
-        if (id == it->id_)
+        throw std::runtime_error("row not found:" + id);
+    }
+    cellCache_.erase(id);
+    if (updating())
+    {
+        // row is dropped from rows_ in endUpdate
+        index_.erase(it);
+        return;
+    }
+    eraseAt(it->second);
+    rows(rows_.size());
+    redraw();
+}
+
+bool StringTable::rowExist(std::string const & id)
+{
+    return index_.count(id) > 0;
+}
+
+void StringTable::clear()
+{
+    selectedRow_ = -1;
+    rows_.clear();
+    index_.clear();
+    cellCache_.clear();
+    if (!updating())
+    {
+        rows(0);
+    }
+}
+
+void StringTable::beginUpdate()
+{
+    if (updateDepth_++ == 0)
+    {
+        updateSelectedId_.clear();
+        if (selectedRow_ >= 0 && selectedRow_ < static_cast<int>(rows_.size()))
         {
-            if (selectedRow_ == row)
-            {
-                selectedRow_ = -1;
-            }
-            if (selectedRow_ > row)
+            updateSelectedId_ = rows_[selectedRow_].id_;
+        }
+    }
+}
+
+void StringTable::endUpdate()
+{
+    assert(updateDepth_ > 0);
+    if (--updateDepth_ > 0)
+    {
+        return;
+    }
+
+    // drop removed rows, a row is live if index_ points to it
+    std::size_t live = 0;
+    for (std::size_t i = 0; i < rows_.size(); ++i)
+    {
+        auto const it = index_.find(rows_[i].id_);
+        if (it != index_.end() && it->second == i)
+        {
+            if (live != i)
             {
-                selectedRow_ -= 1;
+                rows_[live] = std::move(rows_[i]);
             }
-            rows_.erase(it);
-            rows(rows_.size());
-
-            return;
+            ++live;
         }
-        ++row;
     }
+    rows_.erase(rows_.begin() + live, rows_.end());
+
+    std::stable_sort(rows_.begin(), rows_.end(), SortColumn(keyIndex(sort_lastcol_), sort_reverse_));
+    reindex(0);
 
-    // only reached if row not found
-    throw std::runtime_error("row not found:" + id);
+    selectRow(updateSelectedId_); // -1 if selected row was removed
+    updateSelectedId_.clear();
+
+    rows( static_cast<int>(rows_.size()) );
+    row_height_all(col_header_height()+2);
+    redraw();
 }
 
-bool StringTable::rowExist(std::string const & id)
+std::size_t StringTable::insertPosition(StringTableRow const & row)
+{
+    return std::upper_bound(rows_.begin(), rows_.end(), row, SortColumn(keyIndex(sort_lastcol_), sort_reverse_)) - rows_.begin();
+}
+
+void StringTable::insertAt(std::size_t pos, StringTableRow const & row)
+{
+    rows_.insert(rows_.begin() + pos, row);
+    reindex(pos);
+
+    // selection follows its row
+    if (selectedRow_ >= static_cast<int>(pos))
+    {
+        selectedRow_ += 1;
+    }
+}
+
+void StringTable::eraseAt(std::size_t pos)
 {
-    for (StringTableRow & r : rows_)
+    index_.erase(rows_[pos].id_);
+    rows_.erase(rows_.begin() + pos);
+    reindex(pos);
+
+    if (selectedRow_ > static_cast<int>(pos))
+    {
+        selectedRow_ -= 1;
+    }
+    else if (selectedRow_ == static_cast<int>(pos))
     {
-        if (r.id_ == id)
+        selectedRow_ = -1; // updateRow restores selection of moved row
+    }
+}
+
+void StringTable::setSortKeys(StringTableRow & row, StringTableRow const * old)
+{
+    row.sortKeys_.resize(row.data_.size());
+    for (std::size_t c = 0; c < row.data_.size(); ++c)
+    {
+        if (old && c < old->data_.size() && old->data_[c] == row.data_[c])
         {
-            return true;
+            row.sortKeys_[c] = old->sortKeys_[c];
+        }
+        else
+        {
+            row.sortKeys_[c] = sortKey(row.data_[c], headers_[c].sortKind_);
         }
     }
-    return false;
 }
 
-void StringTable::clear()
+std::string StringTable::sortKey(std::string const & text, StringTableColumnDef::SortKind kind)
 {
-    selectedRow_ = -1;
-    rows_.clear();
-    rows(0);
+    std::string key;
+    key.reserve(text.size() + 10);
+
+    switch (kind)
+    {
+    case StringTableColumnDef::SK_INTEGER:
+    {
+        // "\1" and big endian value with flipped sign bit sorts before text, "\0" if no number
+        char * end;
+        long long const val = std::strtoll(text.c_str(), &end, 10);
+        if (end == text.c_str())
+        {
+            key += '\0';
+        }
+        else
+        {
+            key += '\1';
+            uint64_t const u = static_cast<uint64_t>(val) ^ (uint64_t(1) << 63);
+            for (int shift = 56; shift >= 0; shift -= 8)
+            {
+                key += static_cast<char>((u >> shift) & 0xff);
+            }
+        }
+        // rest is compared as text
+        for (char c : text)
+        {
+            key += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        break;
+    }
+
+    case StringTableColumnDef::SK_NATURAL:
+        for (std::size_t i = 0; i < text.size(); )
+        {
+            unsigned char const c = text[i];
+            if (std::isdigit(c))
+            {
+                // digit run is '0', digit count and digits without leading zeros,
+                // a longer number is larger and digits sort before letters like in plain text
+                std::size_t end = i;
+                while (end < text.size() && std::isdigit(static_cast<unsigned char>(text[end]))) ++end;
+                std::size_t begin = i;
+                while (begin + 1 < end && text[begin] == '0') ++begin;
+                key += '0';
+                key += static_cast<char>(std::min<std::size_t>(end - begin, 255));
+                key.append(text, begin, end - begin);
+                i = end;
+            }
+            else
+            {
+                key += static_cast<char>(std::toupper(c));
+                ++i;
+            }
+        }
+        break;
+
+    case StringTableColumnDef::SK_TEXT:
+    default:
+        for (char c : text)
+        {
+            key += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        break;
+    }
+    return key;
+}
+
+void StringTable::reindex(std::size_t from)
+{
+    for (std::size_t i = from; i < rows_.size(); ++i)
+    {
+        index_[rows_[i].id_] = i;
+    }
 }
 
 int StringTable::handle(int event)
@@ -468,26 +812,8 @@ void StringTable::selectRow(int rowIndex)
 
 void StringTable::selectRow(std::string const & id)
 {
-    // do nothing if selectedRow_ is correct
-    if (selectedRow_ != 0 && rows_[selectedRow_].id_ == id)
-    {
-        assert(selectedRow_ < rows());
-        return;
-    }
-
-    int row = 0;
-    for (std::vector<StringTableRow>::iterator it = rows_.begin(); it != rows_.end(); ++it)
-    {
-        if (id == it->id_)
-        {
-            selectedRow_ = row;
-            return;
-        }
-        ++row;
-    }
-
-    // row not found
-    selectedRow_ = -1;
+    auto const it = index_.find(id);
+    selectedRow_ = (it == index_.end()) ? -1 : static_cast<int>(it->second);
 }
 
 StringTable::SortColumn::SortColumn(int col, int reverse)
@@ -496,18 +822,16 @@ StringTable::SortColumn::SortColumn(int col, int reverse)
     reverse_ = reverse;
 }
 
-bool StringTable::SortColumn::operator()(const StringTableRow &a, const StringTableRow &b)
+bool StringTable::SortColumn::operator()(const StringTableRow &a, const StringTableRow &b) const
 {
-    int const aCols = static_cast<int>(a.data_.size());
-    int const bCols = static_cast<int>(b.data_.size());
+    // col_ is index in sortKeys_, only one key per row with a source
+    assert(col_ < static_cast<int>(a.sortKeys_.size()) && col_ < static_cast<int>(b.sortKeys_.size()));
 
-    assert(col_ < aCols && col_ < bCols);
-
-    // copy since we case convert and do case-insensitive comparison
-    std::string as(a.data_[col_]);
-    std::string bs(b.data_[col_]);
-    boost::to_upper(as);
-    boost::to_upper(bs);
+    return less(a.sortKeys_[col_], b.sortKeys_[col_]);
+}
 
-    return ( reverse_ ? as > bs : as < bs );
+bool StringTable::SortColumn::less(std::string const & a, std::string const & b) const
+{
+    // keys are precomputed, no allocation
+    return reverse_ ? b < a : a < b;
 }
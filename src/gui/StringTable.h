@@ -9,24 +9,44 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <unordered_map>
 
 struct StringTableColumnDef
 {
+    // how a column is sorted, all are case insensitive
+    enum SortKind {
+        SK_TEXT,
+        SK_INTEGER, // on leading integer, e.g. "12 8/16", cells without a number first
+        SK_NATURAL  // numbers in text compared as numbers, e.g. "map v9" before "map v10"
+    };
+
     std::string name_;
     int defaultWidth_;
-    StringTableColumnDef(const std::string& name, int defaultWidth):
+    SortKind sortKind_;
+    StringTableColumnDef(const std::string& name, int defaultWidth, SortKind sortKind = SK_TEXT):
         name_(name),
-        defaultWidth_(defaultWidth)
+        defaultWidth_(defaultWidth),
+        sortKind_(sortKind)
     {
     }
 };
 
+// provides the cells of rows added by id, see StringTable::setSource
+class StringTableSource
+{
+public:
+    virtual ~StringTableSource() {}
+    virtual std::vector<std::string> cells(std::string const & id) = 0; // one per column, throws if id is unknown
+    virtual std::string cell(std::string const & id, int col) = 0; // for sort keys of rows not drawn, throws too
+};
+
 struct StringTableRow
 {
     StringTableRow(std::string const & id, std::vector<std::string> const & data): id_(id), data_(data) {}
 
     std::string id_;
-    std::vector<std::string> data_;
+    std::vector<std::string> data_; // empty if table has a source
+    std::vector<std::string> sortKeys_; // set by StringTable, one per cell or only of sort column if table has a source
 
     bool operator==(StringTableRow const & other)
     {
@@ -62,13 +82,42 @@ public:
     StringTableRow const & getRow(std::size_t rowIndex);
     void addRow(StringTableRow const & row);
     void updateRow(StringTableRow const & row);
+
+    // with a source rows are added and updated by id, only the sort key is kept per row and
+    // cells are formatted when drawn and cached for visible rows
+    void setSource(StringTableSource * source); // before any rows are added
+    void addRow(std::string const & id);
+    void updateRow(std::string const & id);
+    std::vector<std::string> const & getCells(std::size_t rowIndex); // works with and without source
     void removeRow(std::string const & id);
     bool rowExist(std::string const & id);
     void sort();
     void clear();
 
+    // adds, updates and removes between beginUpdate and endUpdate are applied with one sort and redraw,
+    // row indexes are not valid until endUpdate, calls can nest
+    void beginUpdate();
+    void endUpdate();
+    bool updating() const { return updateDepth_ > 0; }
+
+    // beginUpdate and endUpdate for a scope
+    class Update
+    {
+    public:
+        explicit Update(StringTable & table): table_(table) { table_.beginUpdate(); }
+        ~Update() { table_.endUpdate(); }
+        Update(Update const &) = delete;
+        Update & operator=(Update const &) = delete;
+    private:
+        StringTable & table_;
+    };
+
+    // returns key where plain string comparison gives the sort order of kind
+    static std::string sortKey(std::string const & text, StringTableColumnDef::SortKind kind);
+
 protected:
-    std::vector<StringTableRow> rows_;
+    std::vector<StringTableRow> rows_; // sorted on sort_lastcol_ when not updating
+    std::unordered_map<std::string, std::size_t> index_; // row id -> rows_ index
     int selectedRow_;
     int handle(int event);
     void selectRow(int rowIndex);
@@ -81,6 +130,16 @@ private:
     Fl_Color fltkColor(std::string const& text); // text is spring color, e.g 0xBBGGRR as int
 
     void sort_column(int col, int reverse=0);                   // sort table by a column
+    std::size_t insertPosition(StringTableRow const & row);     // binary search on current sort column
+    void insertAt(std::size_t pos, StringTableRow const & row);
+    void eraseAt(std::size_t pos);
+    void reindex(std::size_t from);                             // updates index_ for rows_ from index from
+    void setSortKeys(StringTableRow & row, StringTableRow const * old); // keys of cells not changed since old are reused
+    std::string sourceSortKey(std::string const & id, int col); // empty if source fails
+    int keyIndex(int col) const { return source_ ? 0 : col; } // of sort key of column col in sortKeys_
+    void addKeyed(StringTableRow & row);
+    void updateKeyed(std::size_t pos, StringTableRow & row); // row has id and sort keys
+    void pruneCellCache(); // drops cells of rows not visible
     void draw_sort_arrow(int X,int Y,int W,int H,int sort);
     void savePrefs();
 
@@ -88,7 +147,8 @@ private:
     struct SortColumn
     {
         SortColumn(int col, int reverse);
-        bool operator()(const StringTableRow &a, const StringTableRow &b);
+        bool operator()(const StringTableRow &a, const StringTableRow &b) const;
+        bool less(std::string const & a, std::string const & b) const; // a and b are sort keys
         int col_, reverse_;
     };
 
@@ -98,6 +158,13 @@ private:
     Fl_Preferences prefs_;
     bool savePrefs_;
 
+    StringTableSource * source_;
+    std::unordered_map<std::string, std::vector<std::string>> cellCache_; // row id -> cells, with source only
+
+    // batch update state, rows are appended and removed rows left in rows_ (not in index_) until endUpdate
+    int updateDepth_;
+    std::string updateSelectedId_;
+
     static void event_callback(Fl_Widget*, void*);
     void event_callback2();
 
@@ -134,7 +134,7 @@ void Tabs::saidPrivate(std::string const & userName, std::string const & msg)
 
         // connecting to a signal during signal invocation does not guarantee signal being delivered (its unspecified), so add message if chat text is empty
         // this changed when switching to Boost.Signals2, Signals did deliver the signal for me but was unspecified as well
-        if (pc->text_->buffer()->length() == 0)
+        if (pc->text_->empty())
         {
             pc->said(userName, msg);
         }
@@ -3,18 +3,59 @@
 #include "TextDisplay2.h"
 #include "PopupMenu.h"
 #include "LogFile.h"
+#include "LogReader.h"
 #include "log/Log.h"
 #include "TextFunctions.h"
 
 #include <FL/Fl.H>
+#include <FL/Fl_Scrollbar.H>
+#include <FL/fl_draw.H>
+#include <FL/fl_utf8.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <ctime>
 #include <sstream>
-#include <cstring>
 
 
 Fl_Text_Display::Style_Table_Entry TextDisplay2::textStyles_[STYLE_COUNT];
 
+namespace
+{
+
+int const padding = 2; // left and right of text
+std::size_t const maxLength = 20000; // chars kept when at bottom, ten times that when scrolled up
+std::size_t const pageLines = 64; // log lines read at a time
+std::size_t const historyThreadSize = 64*1024; // bigger logs are read in a thread when loading history
+
+std::size_t charLength(std::string const & text, std::size_t offset)
+{
+    int const len = fl_utf8len1(text[offset]);
+    return std::min<std::size_t>(len > 0 ? len : 1, text.size() - offset);
+}
+
+// time stamp like append() adds, with date if not today
+std::string logLineText(LogReader::Line const & line, std::string const & today, std::size_t & timeLength)
+{
+    std::string const date = line.time_.substr(0, 10);
+    std::string const time = (date == today ? std::string() : date + " ") + line.time_.substr(11, 5);
+    timeLength = time.size() + 1;
+
+    std::string text = time + " " + line.text_;
+    boost::replace_all(text, "\t", "    ");
+    return text;
+}
+
+std::string today()
+{
+    char buf[16];
+    std::time_t t = std::time(0);
+    std::tm tm = *std::localtime(&t);
+    std::strftime(buf, 16, "%F", &tm);
+    return buf;
+}
+
+} // namespace
 
 void TextDisplay2::initTextStyles()
 {
@@ -27,42 +68,147 @@ void TextDisplay2::initTextStyles()
 
 
 TextDisplay2::TextDisplay2(int x, int y, int w, int h, LogFile* logFile, char const * label)
-    : Fl_Text_Display(x, y, w, h, label)
+    : Fl_Group(x, y, w, h, label)
+    , buffer_(&TextDisplay2::wrap)
+    , topRow_(0)
+    , selectionAnchor_(Pos { 0, 0 })
+    , selectionCursor_(Pos { 0, 0 })
+    , fontSize_(textStyles_[STYLE_NORMAL].size)
     , logFile_(logFile)
+    , logBegin_(0)
+    , logEnd_(0)
+    , live_(true)
+    , historyLoading_(false)
+    , historyBegin_(0)
+    , historyEnd_(0)
 {
-    textsize(12);
+    logBegin_ = logEnd_ = logSize();
 
     align(FL_ALIGN_TOP_LEFT);
     box(FL_THIN_DOWN_BOX);
-    text_ = new Fl_Text_Buffer();
-    buffer(text_);
-    text_->tab_distance(4);
+    color(FL_BACKGROUND2_COLOR);
 
-    style_ = new Fl_Text_Buffer();
-    int style_size = sizeof(textStyles_)/sizeof(textStyles_[0]);
-    highlight_data(style_, textStyles_, style_size, 'A', 0, 0);
+    int const sw = Fl::scrollbar_size();
+    scrollbar_ = new Fl_Scrollbar(x + w - Fl::box_dx(box()) - sw, y + Fl::box_dy(box()), sw, h - Fl::box_dh(box()));
+    scrollbar_->type(FL_VERTICAL);
+    scrollbar_->linesize(1);
+    scrollbar_->callback(TextDisplay2::callbackScrollbar, this);
+    end();
+}
 
-    wrap_mode(WRAP_AT_BOUNDS, 0);
+TextDisplay2::~TextDisplay2()
+{
+    Fl::remove_timeout(checkHistory, this);
+    if (historyThread_.joinable())
+    {
+        historyThread_.join();
+    }
+}
 
+int TextDisplay2::textX() const
+{
+    return x() + Fl::box_dx(box()) + padding;
 }
 
-TextDisplay2::~TextDisplay2()
+int TextDisplay2::textY() const
+{
+    return y() + Fl::box_dy(box());
+}
+
+int TextDisplay2::textW() const
+{
+    return std::max(1, w() - Fl::box_dw(box()) - Fl::scrollbar_size() - 2*padding);
+}
+
+int TextDisplay2::textH() const
+{
+    return std::max(0, h() - Fl::box_dh(box()));
+}
+
+int TextDisplay2::rowHeight()
+{
+    int height = 1;
+    for (auto const & style : textStyles_)
+    {
+        fl_font(style.font, style.size);
+        height = std::max(height, fl_height());
+    }
+    return height;
+}
+
+std::size_t TextDisplay2::visibleRows() const
 {
+    return std::max(1, textH() / rowHeight());
+}
+
+bool TextDisplay2::atBottom() const
+{
+    return topRow_ + visibleRows() >= buffer_.rows();
+}
+
+void TextDisplay2::scrollToRow(std::size_t row)
+{
+    std::size_t const rows = buffer_.rows();
+    std::size_t const visible = visibleRows();
+    std::size_t const maxTop = rows > visible ? rows - visible : 0;
+    topRow_ = std::min(row, maxTop);
+    updateScrollbar();
+    redraw();
+}
+
+void TextDisplay2::updateScrollbar()
+{
+    int const visible = static_cast<int>(visibleRows());
+    int const rows = static_cast<int>(buffer_.rows());
+    scrollbar_->value(static_cast<int>(topRow_), visible, 0, std::max(rows, visible));
+}
+
+void TextDisplay2::layout()
+{
+    if (fontSize_ != textStyles_[STYLE_NORMAL].size)
+    {
+        fontSize_ = textStyles_[STYLE_NORMAL].size;
+        buffer_.rewrap();
+    }
+    buffer_.width(textW());
+}
+
+void TextDisplay2::resize(int x, int y, int w, int h)
+{
+    bool const bottom = atBottom();
+
+    Fl_Widget::resize(x, y, w, h);
+    int const sw = Fl::scrollbar_size();
+    scrollbar_->resize(x + w - Fl::box_dx(box()) - sw, y + Fl::box_dy(box()), sw, h - Fl::box_dh(box()));
+
+    layout();
+    scrollToRow(bottom ? buffer_.rows() : topRow_);
 }
 
 void TextDisplay2::append(std::string const & text, int interest)
 {
-    // prepends with time stamp and adds newline at end
+    // prepends with time stamp
     // interest: -2=my, -1=low, 0=normal, 1=high
 
+    layout();
+
+    // newer lines than the ones shown are paged in from the log when scrolling down
+    if (!live_)
+    {
+        return;
+    }
+
     // scroll to bottom if last line is visible
-    bool const scrollToBottom = !(mLastChar < text_->length());
+    bool const scrollToBottom = atBottom();
+
+    // callers log text before appending it
+    std::size_t const logBegin = logEnd_;
+    logEnd_ = logSize();
 
     // if string is empty we just add one empty line
     if (text.empty())
     {
-        text_->append("\n");
-        style_->append("\n");
+        buffer_.append(std::string(), 0, STYLE_NORMAL, logBegin, logEnd_);
     }
     else
     {
@@ -70,85 +216,559 @@ void TextDisplay2::append(std::string const & text, int interest)
         std::string const timeNow = getHourMinuteNow();
 
         std::ostringstream oss;
-        oss << timeNow << " " << text << '\n';
-        std::string const line = oss.str();
-
-        text_->append(line.c_str());
+        oss << timeNow << " " << text;
+        std::string line = oss.str();
+        boost::replace_all(line, "\t", "    ");
 
-        // style for time (including trailing space)
-        std::string const styleTime(timeNow.size()+1, 'A');
-        style_->append(styleTime.c_str());
-
-        // style for rest (text + newline)
-        char style;
+        int style;
         switch (interest)
         {
-        case -2: style = 'E'; break;
-        case -1: style = 'B'; break;
-        case  0: style = 'C'; break;
-        case  1: style = 'D'; break;
+        case -2: style = STYLE_MYTEXT; break;
+        case -1: style = STYLE_LOW; break;
+        case  0: style = STYLE_NORMAL; break;
+        case  1: style = STYLE_HIGH; break;
 
         default:
-            style = 'D';
+            style = STYLE_HIGH;
             LOG(WARNING)<< "unknown interest level "<< interest;
             break;
         }
-        std::string const styleText(text.size(), style);
-        style_->append(styleText.c_str());
-        style_->append("\n");
+        // time style includes trailing space
+        buffer_.append(line, timeNow.size()+1, style, logBegin, logEnd_);
     }
 
-    // limit text buffer size, raise limit if we are scrolled up
-    int const maxLength = 20000*(scrollToBottom ? 1 : 10);
-    while (text_->length() > maxLength)
+    // limit text size, raise limit if we are scrolled up, old lines are dropped in chunks
+    std::size_t const dropped = buffer_.trim(maxLength*(scrollToBottom ? 1 : 10));
+    if (dropped > 0)
     {
-        int const posNewline = text_->line_end(0);
-        text_->remove(0, posNewline+1);
-        style_->remove(0, posNewline+1);
+        logBegin_ = buffer_.line(buffer_.firstLine()).logBegin_;
     }
+    keepSelection();
 
     if (scrollToBottom)
     {
-        scroll(text_->length(), 0);
+        scrollToRow(buffer_.rows());
+    }
+    else
+    {
+        // keep showing the same text
+        scrollToRow(topRow_ > dropped ? topRow_ - dropped : 0);
     }
 }
 
-int TextDisplay2::handle(int event)
+void TextDisplay2::clear()
+{
+    buffer_.clear();
+    selectionAnchor_ = selectionCursor_ = Pos { buffer_.firstLine(), 0 };
+    logBegin_ = logEnd_ = logSize();
+    live_ = true;
+    scrollToRow(0);
+}
+
+void TextDisplay2::keepSelection()
+{
+    Pos const first = { buffer_.firstLine(), 0 };
+    Pos const end = { buffer_.endLine(), 0 };
+    if (selectionAnchor_ < first || selectionCursor_ < first || !(selectionAnchor_ < end) || !(selectionCursor_ < end))
+    {
+        selectionAnchor_ = selectionCursor_ = first;
+    }
+}
+
+std::size_t TextDisplay2::logSize()
+{
+    return (logFile_ && LogFile::enabled()) ? logFile_->size() : logEnd_;
+}
+
+bool TextDisplay2::openLog()
+{
+    if (!logFile_ || !LogFile::enabled())
+    {
+        return false;
+    }
+
+    try
+    {
+        if (!logReader_)
+        {
+            std::string const path = logFile_->path();
+            if (!boost::filesystem::exists(path))
+            {
+                return false;
+            }
+            logReader_.reset(new LogReader(path));
+        }
+        logReader_->update();
+    }
+    catch (std::exception const & e)
+    {
+        LOG(WARNING) << "failed to read log: " << e.what();
+        logReader_.reset();
+        return false;
+    }
+    return true;
+}
+
+void TextDisplay2::pageLog(bool up)
+{
+    layout();
+    std::size_t const visible = visibleRows();
+
+    if (up)
+    {
+        while (topRow_ < visible && pageOlder())
+        {
+        }
+    }
+    else
+    {
+        while (!live_ && topRow_ + 2*visible >= buffer_.rows() && pageNewer())
+        {
+        }
+    }
+    scrollToRow(topRow_);
+}
+
+bool TextDisplay2::pageOlder()
+{
+    if (logBegin_ == 0 || !openLog())
+    {
+        return false;
+    }
+
+    std::vector<LogReader::Line> lines;
+    std::size_t const begin = logReader_->linesBefore(logBegin_, pageLines, lines);
+    if (begin >= logBegin_)
+    {
+        return false;
+    }
+
+    prependLog(begin, lines);
+    return true;
+}
+
+void TextDisplay2::prependLog(std::size_t begin, std::vector<LogReader::Line> const & lines)
+{
+    logBegin_ = begin;
+
+    std::size_t const rows = buffer_.rows();
+    std::string const date = today();
+    for (auto it = lines.rbegin(); it != lines.rend(); ++it)
+    {
+        std::size_t timeLength;
+        std::string const text = logLineText(*it, date, timeLength);
+        buffer_.prepend(text, timeLength, STYLE_NORMAL, it->begin_, it->end_);
+    }
+    topRow_ += buffer_.rows() - rows;
+    selectionAnchor_.line_ += lines.size();
+    selectionCursor_.line_ += lines.size();
+
+    // memory is bounded by dropping newest lines
+    if (buffer_.trimBack(maxLength*10) > 0)
+    {
+        live_ = false;
+        logEnd_ = buffer_.line(buffer_.endLine() - 1).logEnd_;
+        keepSelection();
+    }
+}
+
+void TextDisplay2::loadHistory(std::size_t lines)
 {
-    // make mouse wheel scroll in bigger steps if shift is down
-    if (event == FL_MOUSEWHEEL && Fl::event_shift())
+    if (historyThread_.joinable() || logBegin_ == 0 || !openLog())
     {
-        Fl::e_dy *= 3;
+        return;
     }
 
+    historyEnd_ = logBegin_;
+    if (logReader_->size() <= historyThreadSize)
+    {
+        historyBegin_ = logReader_->linesBefore(historyEnd_, lines, history_);
+        showHistory();
+        return;
+    }
+
+    // only the tail is scanned but pages of a big log may have to be read from disk
+    std::string const path = logFile_->path();
+    historyLoading_ = true;
+    historyThread_ = std::thread([this, path, lines]()
+    {
+        try
+        {
+            LogReader reader(path);
+            historyBegin_ = reader.linesBefore(historyEnd_, lines, history_);
+        }
+        catch (std::exception const & e)
+        {
+            LOG(WARNING) << "failed to load history: " << e.what();
+            history_.clear();
+        }
+        historyLoading_ = false;
+    });
+    Fl::add_timeout(0.1, checkHistory, this);
+}
+
+void TextDisplay2::checkHistory(void* data)
+{
+    TextDisplay2 * o = static_cast<TextDisplay2*>(data);
+    if (o->historyLoading_)
+    {
+        Fl::repeat_timeout(0.1, checkHistory, data);
+        return;
+    }
+    o->historyThread_.join();
+    o->showHistory();
+}
+
+void TextDisplay2::showHistory()
+{
+    // lines before the history were paged in or view was cleared while loading
+    if (!history_.empty() && historyEnd_ == logBegin_)
+    {
+        layout();
+        bool const bottom = atBottom();
+        prependLog(historyBegin_, history_);
+        scrollToRow(bottom ? buffer_.rows() : topRow_);
+    }
+    std::vector<LogReader::Line>().swap(history_);
+}
+
+bool TextDisplay2::pageNewer()
+{
+    if (live_ || !openLog())
+    {
+        return false;
+    }
+
+    std::vector<LogReader::Line> lines;
+    std::size_t const end = logReader_->linesAfter(logEnd_, pageLines, lines);
+    if (end <= logEnd_)
+    {
+        live_ = true;
+        return false;
+    }
+    logEnd_ = end;
+
+    std::string const date = today();
+    for (auto const & line : lines)
+    {
+        std::size_t timeLength;
+        std::string const text = logLineText(line, date, timeLength);
+        buffer_.append(text, timeLength, STYLE_NORMAL, line.begin_, line.end_);
+    }
+    live_ = logEnd_ >= logReader_->size();
+
+    std::size_t const dropped = buffer_.trim(maxLength*10);
+    if (dropped > 0)
+    {
+        topRow_ = topRow_ > dropped ? topRow_ - dropped : 0;
+        logBegin_ = buffer_.line(buffer_.firstLine()).logBegin_;
+        keepSelection();
+    }
+    return true;
+}
+
+std::vector<std::size_t> TextDisplay2::wrap(ChatBuffer::Line const & line, int width)
+{
+    // wraps at spaces, words longer than width are wrapped anywhere
+    std::vector<std::size_t> breaks;
+    std::string const & text = line.text_;
+    double x = 0;
+    std::size_t pos = 0;
+
+    while (pos < text.size())
+    {
+        // word with trailing spaces, time stamp is one word
+        std::size_t end = text.find(' ', pos);
+        end = (end == std::string::npos) ? text.size() : text.find_first_not_of(' ', end);
+        if (end == std::string::npos)
+        {
+            end = text.size();
+        }
+        if (pos < line.timeLength_ && end > line.timeLength_)
+        {
+            end = line.timeLength_;
+        }
+        std::size_t wordEnd = end;
+        while (wordEnd > pos && text[wordEnd-1] == ' ')
+        {
+            --wordEnd;
+        }
+
+        setFont(line, pos);
+        double const wordW = fl_width(text.c_str() + pos, static_cast<int>(wordEnd - pos));
+        if (x > 0 && x + wordW > width)
+        {
+            breaks.push_back(pos);
+            x = 0;
+        }
+
+        if (wordW > width)
+        {
+            for (std::size_t p = pos; p < wordEnd; )
+            {
+                std::size_t const len = charLength(text, p);
+                double const charW = fl_width(text.c_str() + p, static_cast<int>(len));
+                if (x > 0 && x + charW > width)
+                {
+                    breaks.push_back(p);
+                    x = 0;
+                }
+                x += charW;
+                p += len;
+            }
+            x += fl_width(text.c_str() + wordEnd, static_cast<int>(end - wordEnd));
+        }
+        else
+        {
+            x += fl_width(text.c_str() + pos, static_cast<int>(end - pos));
+        }
+        pos = end;
+    }
+    return breaks;
+}
+
+void TextDisplay2::setFont(ChatBuffer::Line const & line, std::size_t offset)
+{
+    auto const & style = textStyles_[offset < line.timeLength_ ? STYLE_TIME : line.style_];
+    fl_font(style.font, style.size);
+}
+
+void TextDisplay2::draw()
+{
+    layout();
+    if (topRow_ > 0 && topRow_ >= buffer_.rows())
+    {
+        scrollToRow(buffer_.rows());
+    }
+
+    draw_box();
+    fl_push_clip(x() + Fl::box_dx(box()), textY(), textW() + 2*padding, textH());
+
+    int const rh = rowHeight();
+    if (topRow_ < buffer_.rows())
+    {
+        auto const first = buffer_.findRow(topRow_);
+        std::size_t lineNo = first.first;
+        std::size_t row = first.second;
+        for (int y = textY(); y < textY() + textH() && lineNo < buffer_.endLine(); y += rh)
+        {
+            ChatBuffer::Line const & line = buffer_.line(lineNo);
+            drawRow(line, lineNo, row, y);
+            if (++row >= line.rows())
+            {
+                row = 0;
+                ++lineNo;
+            }
+        }
+    }
+
+    fl_pop_clip();
+    draw_child(*scrollbar_);
+}
+
+void TextDisplay2::drawRow(ChatBuffer::Line const & line, std::size_t lineNo, std::size_t row, int y)
+{
+    std::size_t const begin = line.rowBegin(row);
+    std::size_t const end = line.rowEnd(row);
+    int const rh = rowHeight();
+
+    // selected part of line
+    Pos const lo = std::min(selectionAnchor_, selectionCursor_);
+    Pos const hi = std::max(selectionAnchor_, selectionCursor_);
+    std::size_t selBegin = 0;
+    std::size_t selEnd = 0;
+    if (hasSelection() && lo.line_ <= lineNo && lineNo <= hi.line_)
+    {
+        selBegin = (lineNo == lo.line_) ? lo.offset_ : 0;
+        selEnd = (lineNo == hi.line_) ? hi.offset_ : line.text_.size();
+    }
+
+    // row is drawn in segments of one style and selection state
+    std::vector<std::size_t> cuts = { begin, end };
+    for (std::size_t cut : { line.timeLength_, selBegin, selEnd })
+    {
+        if (cut > begin && cut < end)
+        {
+            cuts.push_back(cut);
+        }
+    }
+    std::sort(cuts.begin(), cuts.end());
+
+    double x = textX();
+    for (std::size_t i = 0; i + 1 < cuts.size(); ++i)
+    {
+        std::size_t const segBegin = cuts[i];
+        std::size_t const segEnd = cuts[i+1];
+        if (segBegin == segEnd)
+        {
+            continue;
+        }
+
+        setFont(line, segBegin);
+        char const * str = line.text_.c_str() + segBegin;
+        int const n = static_cast<int>(segEnd - segBegin);
+        double const segW = fl_width(str, n);
+        Fl_Color const textColor = textStyles_[segBegin < line.timeLength_ ? STYLE_TIME : line.style_].color;
+
+        if (segBegin >= selBegin && segEnd <= selEnd)
+        {
+            fl_color(selection_color());
+            fl_rectf(static_cast<int>(x), y, static_cast<int>(segW + 1), rh);
+            fl_color(fl_contrast(textColor, selection_color()));
+        }
+        else
+        {
+            // contrast like Fl_Text_Display
+            fl_color(fl_contrast(textColor, color()));
+        }
+        fl_draw(str, n, static_cast<int>(x), y + rh - fl_descent());
+        x += segW;
+    }
+}
+
+bool TextDisplay2::hit(int x, int y, Pos & pos)
+{
+    layout();
+    std::size_t const rows = buffer_.rows();
+    if (rows == 0)
+    {
+        pos = Pos { buffer_.firstLine(), 0 };
+        return false;
+    }
+
+    bool inside = y >= textY() && y < textY() + textH();
+    int const rowOffset = (y - textY()) / rowHeight();
+    std::size_t row = (y < textY()) ? topRow_ : topRow_ + rowOffset;
+    if (row >= rows)
+    {
+        row = rows - 1;
+        inside = false;
+    }
+
+    auto const lineRow = buffer_.findRow(row);
+    ChatBuffer::Line const & line = buffer_.line(lineRow.first);
+    std::size_t const end = line.rowEnd(lineRow.second);
+    std::size_t offset = line.rowBegin(lineRow.second);
+
+    double cx = textX();
+    while (offset < end)
+    {
+        std::size_t const len = charLength(line.text_, offset);
+        setFont(line, offset);
+        double const charW = fl_width(line.text_.c_str() + offset, static_cast<int>(len));
+        if (cx + charW/2 > x)
+        {
+            break;
+        }
+        cx += charW;
+        offset += len;
+    }
+    if (offset == end && x > cx)
+    {
+        inside = false;
+    }
+
+    pos = Pos { lineRow.first, offset };
+    return inside;
+}
+
+std::string TextDisplay2::selectionText() const
+{
+    Pos const lo = std::min(selectionAnchor_, selectionCursor_);
+    Pos const hi = std::max(selectionAnchor_, selectionCursor_);
+
+    std::string text;
+    for (std::size_t n = std::max(lo.line_, buffer_.firstLine()); n <= hi.line_ && n < buffer_.endLine(); ++n)
+    {
+        std::string const & line = buffer_.line(n).text_;
+        std::size_t const begin = (n == lo.line_) ? std::min(lo.offset_, line.size()) : 0;
+        std::size_t const end = (n == hi.line_) ? std::min(hi.offset_, line.size()) : line.size();
+        if (n != lo.line_)
+        {
+            text += '\n';
+        }
+        text.append(line, begin, end - begin);
+    }
+    return text;
+}
+
+int TextDisplay2::handle(int event)
+{
     switch (event)
     {
-    case FL_PUSH: // handle double click on text with web link
-        if (Fl::event_clicks() && Fl::event_button() == FL_LEFT_MOUSE)
+    case FL_MOUSEWHEEL:
+        if (Fl::e_dy != 0)
         {
-            int const pos = xy_to_position(Fl::event_x(), Fl::event_y());
-            if (pos < text_->length())
+            // scroll in bigger steps if shift is down
+            long const step = 3 * (Fl::event_shift() ? 3 : 1);
+            long const row = static_cast<long>(topRow_) + Fl::e_dy*step;
+            scrollToRow(static_cast<std::size_t>(std::max(0L, row)));
+            pageLog(Fl::e_dy < 0);
+            return 1;
+        }
+        break;
+
+    case FL_FOCUS:
+    case FL_UNFOCUS:
+        return 1;
+
+    case FL_KEYBOARD:
+        if ((Fl::event_state() & FL_CTRL) && Fl::event_key() == 'c' && hasSelection())
+        {
+            std::string const text = selectionText();
+            Fl::copy(text.c_str(), static_cast<int>(text.size()), 1 /* clipboard */);
+            return 1;
+        }
+        switch (Fl::event_key())
+        {
+        case FL_Page_Up:
+            scrollToRow(topRow_ > visibleRows() ? topRow_ - visibleRows() : 0);
+            pageLog(true);
+            return 1;
+        case FL_Page_Down:
+            scrollToRow(topRow_ + visibleRows());
+            pageLog(false);
+            return 1;
+        }
+        break;
+
+    case FL_PUSH:
+        if (Fl::event_inside(scrollbar_))
+        {
+            break;
+        }
+        if (Fl::event_button() == FL_LEFT_MOUSE)
+        {
+            take_focus();
+            Pos pos;
+            bool const inside = hit(Fl::event_x(), Fl::event_y(), pos);
+
+            // double click on text with web link
+            if (Fl::event_clicks() && inside)
             {
-                int posStart;
-                if (text_->search_backward(pos, "http", &posStart) && posStart >= text_->line_start(pos))
+                std::string const & text = buffer_.line(pos.line_).text_;
+                std::size_t const posStart = text.rfind("http", pos.offset_);
+                if (posStart != std::string::npos)
                 {
-                    int posSpace;
-                    int posNewline;
-                    int found = 0;
-                    found += text_->findchar_forward(posStart, ' ', &posSpace);
-                    found += text_->findchar_forward(posStart, '\n', &posNewline);
-                    if (found > 0)
+                    std::size_t posEnd = text.find(' ', posStart);
+                    if (posEnd == std::string::npos)
+                    {
+                        posEnd = text.size();
+                    }
+                    if (pos.offset_ < posEnd)
                     {
-                        int const posEnd = std::min(posSpace, posNewline);
-                        text_->select(posStart, posEnd);
-                        char * sel = text_->selection_text();
-                        std::string const link = sel;
-                        ::free(sel);
-                        flOpenUri(link);
+                        selectionAnchor_ = Pos { pos.line_, posStart };
+                        selectionCursor_ = Pos { pos.line_, posEnd };
+                        redraw();
+                        flOpenUri(text.substr(posStart, posEnd - posStart));
                         return 1;
                     }
                 }
             }
+
+            selectionAnchor_ = selectionCursor_ = pos;
+            redraw();
+            return 1;
         }
         else if (Fl::event_button() == FL_RIGHT_MOUSE && Fl::event_clicks() == 0)
         {
@@ -164,8 +784,7 @@ int TextDisplay2::handle(int event)
             switch (id)
             {
             case 1:
-                text_->remove(0, text_->length());
-                style_->remove(0, style_->length());
+                clear();
                 return 1;
             case 2:
                 LogFile::openLogFile(logFile_->path());
@@ -173,7 +792,45 @@ int TextDisplay2::handle(int event)
             }
         }
         break;
+
+    case FL_DRAG:
+        if (Fl::event_button() == FL_LEFT_MOUSE)
+        {
+            // scroll when dragging above or below text
+            if (Fl::event_y() < textY())
+            {
+                scrollToRow(topRow_ > 0 ? topRow_ - 1 : 0);
+                pageLog(true);
+            }
+            else if (Fl::event_y() >= textY() + textH())
+            {
+                scrollToRow(topRow_ + 1);
+                pageLog(false);
+            }
+            hit(Fl::event_x(), Fl::event_y(), selectionCursor_);
+            redraw();
+            return 1;
+        }
+        break;
+
+    case FL_RELEASE:
+        if (Fl::event_button() == FL_LEFT_MOUSE && hasSelection())
+        {
+            std::string const text = selectionText();
+            Fl::copy(text.c_str(), static_cast<int>(text.size()), 0 /* selection buffer */);
+            return 1;
+        }
+        break;
     }
 
-    return Fl_Text_Display::handle(event);
+    return Fl_Group::handle(event);
+}
+
+void TextDisplay2::callbackScrollbar(Fl_Widget*, void* data)
+{
+    TextDisplay2 * o = static_cast<TextDisplay2*>(data);
+    std::size_t const row = static_cast<std::size_t>(std::max(0, static_cast<int>(o->scrollbar_->value())));
+    bool const up = row < o->topRow_;
+    o->topRow_ = row;
+    o->pageLog(up);
 }
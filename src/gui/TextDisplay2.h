@@ -2,19 +2,33 @@
 
 #pragma once
 
-#include <FL/Fl_Text_Display.H>
+#include "ChatBuffer.h"
+#include "LogReader.h"
+
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Text_Display.H> // Style_Table_Entry
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 class LogFile;
-class Fl_Text_Buffer;
+class Fl_Scrollbar;
 
-class TextDisplay2: public Fl_Text_Display
+// Chat text view, lines are kept in a ChatBuffer with their wrapping for the current width and
+// only visible rows are drawn. Old lines are dropped a chunk at a time.
+// Scrolling near the top pages older lines in from the log file, the lines kept are a window on the log
+// so newer lines are dropped then and paged in again when scrolling down.
+class TextDisplay2: public Fl_Group
 {
 public:
     TextDisplay2(int x, int y, int w, int h, LogFile* logFile = nullptr, char const * label = 0);
     virtual ~TextDisplay2();
 
     void append(std::string const & text, int interest = 0);
+    void loadHistory(std::size_t lines = 100); // shows last lines of log file, big logs are read in a thread
+    bool empty() const { return buffer_.empty(); }
 
     enum {
         STYLE_TIME = 0,
@@ -28,11 +42,67 @@ public:
     static void initTextStyles(); // call after setting font size
 
 private:
-    Fl_Text_Buffer * text_;
-    Fl_Text_Buffer * style_;
+    // position in text, line is a ChatBuffer line number
+    struct Pos
+    {
+        std::size_t line_;
+        std::size_t offset_;
+        bool operator<(Pos const & p) const { return line_ < p.line_ || (line_ == p.line_ && offset_ < p.offset_); }
+        bool operator==(Pos const & p) const { return line_ == p.line_ && offset_ == p.offset_; }
+    };
+
+    ChatBuffer buffer_;
+    Fl_Scrollbar * scrollbar_;
+    std::size_t topRow_; // first visible row
+    Pos selectionAnchor_;
+    Pos selectionCursor_;
+    int fontSize_; // of textStyles_ when lines were wrapped
 
     LogFile* logFile_;
+    std::unique_ptr<LogReader> logReader_; // opened when paging
+    std::size_t logBegin_; // offsets in log file of lines kept
+    std::size_t logEnd_;
+    bool live_; // new lines are shown, false when newer lines were dropped
+
+    std::thread historyThread_;
+    std::atomic<bool> historyLoading_;
+    std::size_t historyBegin_; // lines read by historyThread_, before historyEnd_
+    std::size_t historyEnd_;
+    std::vector<LogReader::Line> history_;
+
+    int handle(int event) override;
+    void draw() override;
+    void resize(int x, int y, int w, int h) override;
+
+    int textX() const;
+    int textY() const;
+    int textW() const;
+    int textH() const;
+    static int rowHeight();
+    std::size_t visibleRows() const;
+    bool atBottom() const;
+    void scrollToRow(std::size_t row);
+    void updateScrollbar();
+    void layout(); // wraps lines for current width and font
+
+    std::size_t logSize();
+    bool openLog();
+    void pageLog(bool up); // pages log lines in if scrolled near top or bottom
+    bool pageOlder();
+    bool pageNewer();
+    void prependLog(std::size_t begin, std::vector<LogReader::Line> const & lines);
+    void showHistory();
+    void keepSelection();
+
+    static std::vector<std::size_t> wrap(ChatBuffer::Line const & line, int width);
+    static void setFont(ChatBuffer::Line const & line, std::size_t offset);
+    void drawRow(ChatBuffer::Line const & line, std::size_t lineNo, std::size_t row, int y);
 
-    int handle(int event);
+    bool hit(int x, int y, Pos & pos); // false if no text at x,y
+    bool hasSelection() const { return !(selectionAnchor_ == selectionCursor_); }
+    std::string selectionText() const;
+    void clear();
 
+    static void callbackScrollbar(Fl_Widget*, void*);
+    static void checkHistory(void*);
 };
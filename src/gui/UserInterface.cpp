@@ -23,6 +23,7 @@
 #include "FontSettingsDialog.h"
 #include "DownloadSettingsDialog.h"
 #include "OpenBattleZkDialog.h"
+#include "MyImage.h"
 
 #include "log/Log.h"
 #include "model/Model.h"
@@ -33,7 +34,6 @@
 #include <X11/extensions/scrnsaver.h>
 #include <FL/x.H>
 #include "icon.xpm.h"
-#include <Magick++.h>
 
 #include <FL/Fl_Double_Window.H>
 #include <FL/Fl_Menu_Bar.H>
@@ -66,8 +66,7 @@ static UserInterface* gUserInterface = nullptr;
 UserInterface::UserInterface(Model & model) :
     model_(model),
     cache_(new Cache(model_)),
-    genJobsCount_(0),
-    openMapsWindow_(false)
+    genJobsCount_(0)
 {
     TextDisplay2::initTextStyles();
 
@@ -175,8 +174,15 @@ UserInterface::UserInterface(Model & model) :
     model.connectJoinBattleFailed( boost::bind(&UserInterface::joinBattleFailed, this, _1) );
     model.connectDownloadDone( boost::bind(&UserInterface::downloadDone, this, _1, _2, _3) );
     model.connectStartDemo(boost::bind(&UserInterface::startDemo, this, _1, _2) );
+    model.connectContentChanged( boost::bind(&UserInterface::contentChanged, this, _1, _2) );
 
-    Magick::InitializeMagick(0);
+    // archives added or removed in the spring data dirs
+    if (model_.contentWatcherFd() >= 0)
+    {
+        Fl::add_fd(model_.contentWatcherFd(), FL_READ, onContentEvent, this);
+    }
+
+    MyImage::registerHandler();
 
     gUserInterface = this;
 }
@@ -191,6 +197,12 @@ UserInterface::~UserInterface()
     prefs().set(PrefAppWindowSplitH, battleRoom_->x());
     prefs().set(PrefLeftSplitV, battleList_->y());
 
+    if (model_.contentWatcherFd() >= 0)
+    {
+        Fl::remove_fd(model_.contentWatcherFd());
+    }
+    Fl::remove_timeout(contentSettled, this);
+
     delete channelsWindow_;
     delete mapsWindow_;
     delete loginDialog_;
@@ -254,6 +266,9 @@ int UserInterface::run(int argc, char** argv)
     // select current spring profile (spring and unitsync)
     bool const pathsOk = springDialog_->setPaths();
 
+    // clean the map cache when startup is done
+    Fl::add_timeout(30, collectCacheGarbage, this);
+
     if (loginDialog_->autoLogin())
     {
         loginDialog_->attemptLogin();
@@ -335,7 +350,7 @@ void UserInterface::onTest(Fl_Widget *w, void* d)
 //     Sound::beep();
 //     ui->sound_->play();
 //
-//     m.getModAIs("Zero-K v1.0.3.8");
+//     m.getGameInfo("Zero-K v1.0.3.8");
 
 #if 0
     auto maps = m.getMaps();
@@ -482,6 +497,10 @@ void UserInterface::menuRefresh(Fl_Widget *w, void* d)
 {
     UserInterface * ui = static_cast<UserInterface*>(d);
     ui->reloadMapsMods();
+
+    // archives replaced by others with the same names are not reported as content changes
+    ui->battleList_->refresh();
+    ui->battleRoom_->refresh();
 }
 
 void UserInterface::menuGenerateCacheFiles(Fl_Widget *w, void* d)
@@ -513,30 +532,8 @@ void UserInterface::menuMaps(Fl_Widget *w, void* d)
 {
     UserInterface * ui = static_cast<UserInterface*>(d);
 
-    if (!ui->genJobs_.empty())
-    {
-        LOG(WARNING)<< "map generate job already in progress";
-        return;
-    }
-
-    auto maps = ui->model_.getMaps();
-    for (auto const& map : maps)
-    {
-        if (!ui->cache_->hasMapImage(map)) ui->genJobs_.push_back(GenJob(map, GEN_MAP));
-    }
-
-    if (!ui->genJobs_.empty())
-    {
-        ProgressDialog::open("Generating map images ...");
-
-        ui->genJobsCount_ = ui->genJobs_.size();
-        Fl::add_timeout(0, doGenJob, ui);
-        ui->openMapsWindow_ = true;
-    }
-    else
-    {
-        ui->mapsWindow_->show();
-    }
+    // map images are loaded (and generated if missing) by the maps window when shown
+    ui->mapsWindow_->show();
 }
 
 void UserInterface::menuOpenBattleZk(Fl_Widget *w, void* d)
@@ -628,9 +625,52 @@ void UserInterface::enableMenuItem(void(*cb)(Fl_Widget*, void*), bool enable)
 
 void UserInterface::reloadMapsMods()
 {
-    model_.refresh();
+    model_.refresh(); // views are updated in contentChanged
+    cache_->collectGarbage();
+}
+
+void UserInterface::contentChanged(std::vector<std::string> const& maps, std::vector<std::string> const& gameArchives)
+{
     battleList_->refresh();
-    battleRoom_->refresh();
+
+    // battle room is only updated if its map or game could be affected
+    int const battleId = battleRoom_->battleId();
+    if (battleId != -1)
+    {
+        Battle const& battle = model_.getBattle(battleId);
+        if (!gameArchives.empty() || std::find(maps.begin(), maps.end(), battle.mapName()) != maps.end())
+        {
+            battleRoom_->refresh();
+        }
+    }
+
+    if (!maps.empty())
+    {
+        mapsWindow_->refresh();
+    }
+}
+
+void UserInterface::onContentEvent(int fd, void* d)
+{
+    UserInterface * ui = static_cast<UserInterface*>(d);
+    if (ui->model_.readContentChanges())
+    {
+        // downloads often add several archives, reload when no changes for a while
+        Fl::remove_timeout(contentSettled, d);
+        Fl::add_timeout(2.0, contentSettled, d);
+    }
+}
+
+void UserInterface::contentSettled(void* d)
+{
+    UserInterface * ui = static_cast<UserInterface*>(d);
+    ui->reloadMapsMods();
+}
+
+void UserInterface::collectCacheGarbage(void* d)
+{
+    UserInterface * ui = static_cast<UserInterface*>(d);
+    ui->cache_->collectGarbage();
 }
 
 void UserInterface::downloadDone(Model::DownloadType downloadType, std::string const& name, bool success)
@@ -763,22 +803,12 @@ void UserInterface::doGenJob(void* d)
         // canceled by user
         ui->genJobs_.clear();
         ProgressDialog::close();
-        ui->openMapsWindow_ = false;
     }
     else if (ui->genJobs_.empty())
     {
-        if (ui->openMapsWindow_)
-        {
-            ProgressDialog::close();
-            ui->mapsWindow_->show();
-            ui->openMapsWindow_ = false;
-        }
-        else
-        {
-            // show Done for a short time
-            ProgressDialog::progress(100, "Done");
-            Fl::add_timeout(0.5, closeProgressDialog, d);
-        }
+        // show Done for a short time
+        ProgressDialog::progress(100, "Done");
+        Fl::add_timeout(0.5, closeProgressDialog, d);
     }
     else
     {
@@ -73,7 +73,6 @@ private:
     };
     std::deque<GenJob> genJobs_;
     std::size_t genJobsCount_;
-    bool openMapsWindow_; // used for showing maps windows after map image files generation is done
 
     Fl_Double_Window * mainWindow_;
     std::string startTitle_;
@@ -110,6 +109,9 @@ private:
     void loginResult(bool success, std::string const & info);
     void joinBattleFailed(std::string const & reason);
     void downloadDone(Model::DownloadType downloadType, std::string const& name, bool success);
+    void contentChanged(std::vector<std::string> const& maps, std::vector<std::string> const& gameArchives);
+    static void onContentEvent(int fd, void* d);
+    static void contentSettled(void* d);
     void startDemo(std::string const& engineVersion, std::string const& demoFile);
 
     // other signal handlers
@@ -140,6 +142,7 @@ private:
     static void checkAway(void* d);
     static void doGenJob(void* d);
     static void closeProgressDialog(void* d);
+    static void collectCacheGarbage(void* d);
     static void quitHandler(void* d);
     static void menuOpenBattleZk(Fl_Widget *w, void* d);
 
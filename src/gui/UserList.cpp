@@ -17,15 +17,22 @@ UserList::UserList(int x, int y, int w, int h, Model & model, ITabs & iTabs, boo
     model_(model),
     iTabs_(iTabs)
 {
+    setSource(this);
     connectRowClicked( boost::bind(&UserList::userClicked, this, _1, _2) );
     connectRowDoubleClicked( boost::bind(&UserList::userDoubleClicked, this, _1, _2) );
-
-    model_.connectUserChanged( boost::bind(&UserList::userChanged, this, _1) );
 }
 
 void UserList::add(User const & user)
 {
-    addRow(makeRow(user));
+    addRow(user.name());
+    if (updating())
+    {
+        names_.addUnsorted(user.name());
+    }
+    else
+    {
+        names_.add(user.name());
+    }
 }
 
 void UserList::add(std::string const & userName)
@@ -37,15 +44,39 @@ void UserList::add(std::string const & userName)
 void UserList::remove(std::string const & userName)
 {
     removeRow(userName);
+    names_.remove(userName);
 }
 
-StringTableRow UserList::makeRow(User const & user)
+void UserList::clear()
 {
-    return StringTableRow( user.name(),
-        {
-            user.name(),
-            statusString(user)
-        } );
+    StringTable::clear();
+    names_.clear();
+}
+
+std::vector<std::string> UserList::cells(std::string const & userName)
+{
+    User const & user = model_.getUser(userName);
+    std::vector<std::string> cells;
+    for (int col = 0; col < cols(); ++col)
+    {
+        cells.push_back(cell(user, col));
+    }
+    return cells;
+}
+
+std::string UserList::cell(std::string const & userName, int col)
+{
+    return cell(model_.getUser(userName), col);
+}
+
+std::string UserList::cell(User const & user, int col)
+{
+    switch (col)
+    {
+    case 0: return user.name();
+    case 1: return statusString(user);
+    }
+    return std::string();
 }
 
 std::string UserList::statusString(User const & user)
@@ -60,13 +91,9 @@ std::string UserList::statusString(User const & user)
 
 void UserList::userChanged(User const & user)
 {
-    try
+    if (rowExist(user.name()))
     {
-        updateRow(makeRow(user)); // throws if row not found
-    }
-    catch (std::runtime_error & e)
-    {
-        // ignore
+        updateRow(user.name());
     }
 }
 
@@ -176,35 +203,11 @@ void UserList::userDoubleClicked(int rowIndex, int button)
 
 std::string UserList::completeUserName(std::string const& text, std::string const& ignore)
 {
-    std::string fullUserName;
-
     if (text.empty())
     {
         LOG(DEBUG)<< "ignored trying to complete empty string";
-        return fullUserName;
-    }
-
-    std::vector<std::string> userNames;
-
-    for (int i=0; i<rows(); ++i)
-    {
-        StringTableRow const & row = getRow(static_cast<std::size_t>(i));
-        try
-        {
-            User const & user = model_.getUser(row.data_[0]);
-            userNames.push_back(row.data_[0]);
-        }
-        catch (std::invalid_argument const & e)
-        {
-            LOG(WARNING)<< "unexpected exception: "<< e.what();
-        }
-    }
-
-    auto const match = findMatch(userNames, text, ignore);
-    if (!match.empty())
-    {
-        fullUserName = match;
+        return std::string();
     }
 
-    return fullUserName;
+    return names_.complete(text, ignore);
 }
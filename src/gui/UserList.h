@@ -3,6 +3,7 @@
 #pragma once
 
 #include "StringTable.h"
+#include "NameIndex.h"
 
 #include <string>
 
@@ -10,7 +11,8 @@ class Model;
 class ITabs;
 class User;
 
-class UserList: public StringTable
+// rows are formatted from the model when drawn, the list only keeps user names
+class UserList: public StringTable, public StringTableSource
 {
 public:
     UserList(int x, int y, int w, int h, Model & model, ITabs & iTabs, bool savePrefs = false);
@@ -18,20 +20,25 @@ public:
     void add(User const & user);
     void add(std::string const & userName);
     void remove(std::string const & userName);
+    void clear(); // hides StringTable::clear to also clear names_
 
     std::string completeUserName(std::string const& text, std::string const& ignore);
 
+    // connected by owner to the model signal for the users it shows
+    void userChanged(User const & user);
+
 private:
     Model & model_;
     ITabs & iTabs_;
+    NameIndex names_; // for completeUserName
 
-    StringTableRow makeRow(User const & user);
+    // StringTableSource
+    std::vector<std::string> cells(std::string const & userName);
+    std::string cell(std::string const & userName, int col);
+    std::string cell(User const & user, int col);
     std::string statusString(User const & user);
 
     // StringTable signals
     void userClicked(int rowIndex, int button);
     void userDoubleClicked(int rowIndex, int button);
-
-    // model signals
-    void userChanged(User const & user);
 };
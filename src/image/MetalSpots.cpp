@@ -0,0 +1,148 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "MetalSpots.h"
+
+#include <stdexcept>
+#include <numeric>
+
+namespace MetalSpots
+{
+
+namespace
+{
+
+// run of metal pixels on one row, x1 is one past the last pixel
+struct Run
+{
+    int y_;
+    int x0_;
+    int x1_;
+    int label_;
+};
+
+int findRoot(std::vector<int> & parents, int label)
+{
+    int root = label;
+    while (parents[root] != root)
+    {
+        root = parents[root];
+    }
+    // path compression
+    while (parents[label] != root)
+    {
+        int const next = parents[label];
+        parents[label] = root;
+        label = next;
+    }
+    return root;
+}
+
+void unite(std::vector<int> & parents, int a, int b)
+{
+    a = findRoot(parents, a);
+    b = findRoot(parents, b);
+    if (a != b)
+    {
+        // lowest label is root so spots keep row order of first pixel
+        if (a < b) parents[b] = a;
+        else parents[a] = b;
+    }
+}
+
+struct Sum
+{
+    double metal_;
+    double x_;
+    double y_;
+    int pixels_;
+};
+
+} // namespace
+
+std::vector<Spot> find(uint8_t const * metal, int w, int h, uint8_t threshold, int minPixels, PixelKernels::Isa isa)
+{
+    if (w <= 0 || h <= 0)
+    {
+        throw std::invalid_argument("bad metal map size");
+    }
+
+    // find runs per row and connect them to overlapping runs (including diagonals) on the row above
+    std::vector<Run> runs;
+    std::vector<int> parents; // union find of run labels
+    std::size_t prevBegin = 0; // runs of row above
+    std::size_t prevEnd = 0;
+
+    for (int y=0; y<h; ++y)
+    {
+        uint8_t const * row = metal + static_cast<std::size_t>(y)*w;
+        std::size_t const rowBegin = runs.size();
+        std::size_t prev = prevBegin;
+
+        int x = 0;
+        while (x < w)
+        {
+            x += PixelKernels::findAbove(row + x, w - x, threshold, isa);
+            if (x >= w) break;
+            int const x0 = x;
+            x += PixelKernels::findNotAbove(row + x, w - x, threshold, isa);
+
+            Run run = { y, x0, x, static_cast<int>(parents.size()) };
+            parents.push_back(run.label_);
+
+            // runs above touch if they overlap the run extended by one pixel on each side
+            while (prev < prevEnd && runs[prev].x1_ < run.x0_)
+            {
+                ++prev;
+            }
+            for (std::size_t p = prev; p < prevEnd && runs[p].x0_ <= run.x1_; ++p)
+            {
+                unite(parents, runs[p].label_, run.label_);
+            }
+            runs.push_back(run);
+        }
+
+        prevBegin = rowBegin;
+        prevEnd = runs.size();
+    }
+
+    // sum per spot, indexed by root label
+    std::vector<Sum> sums(parents.size(), Sum { 0, 0, 0, 0 });
+    for (auto const & run : runs)
+    {
+        Sum & sum = sums[findRoot(parents, run.label_)];
+        uint8_t const * row = metal + static_cast<std::size_t>(run.y_)*w;
+        for (int x=run.x0_; x<run.x1_; ++x)
+        {
+            double const m = row[x];
+            sum.metal_ += m;
+            sum.x_ += m*(x + 0.5);
+            sum.y_ += m*(run.y_ + 0.5);
+        }
+        sum.pixels_ += run.x1_ - run.x0_;
+    }
+
+    std::vector<Spot> spots;
+    for (std::size_t label=0; label<sums.size(); ++label)
+    {
+        Sum const & sum = sums[label];
+        if (parents[label] != static_cast<int>(label) || sum.pixels_ < minPixels || sum.metal_ <= 0)
+        {
+            continue;
+        }
+        Spot const spot = {
+            static_cast<float>(sum.x_/sum.metal_/w),
+            static_cast<float>(sum.y_/sum.metal_/h),
+            static_cast<float>(sum.metal_/255),
+            sum.pixels_ };
+        spots.push_back(spot);
+    }
+    return spots;
+}
+
+float totalMetal(std::vector<Spot> const & spots)
+{
+    return std::accumulate(spots.begin(), spots.end(), 0.0f,
+                           [](float total, Spot const & spot) { return total + spot.metal_; });
+}
+
+} // namespace
@@ -0,0 +1,30 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include "PixelKernels.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace MetalSpots
+{
+
+struct Spot
+{
+    float x_; // center, weighted by metal, relative to map width (0-1)
+    float y_; // relative to map height (0-1)
+    float metal_; // sum of metal map values / 255
+    int pixels_; // metal map pixels in spot
+};
+
+// finds the metal spots in a w x h metal map (unitsync info map "metal"),
+// a spot is a group of 8-connected pixels with value above threshold,
+// groups with fewer than minPixels pixels are ignored,
+// spots are returned in row order of their first pixel
+std::vector<Spot> find(uint8_t const * metal, int w, int h, uint8_t threshold = 0, int minPixels = 2,
+                       PixelKernels::Isa isa = PixelKernels::bestIsa());
+
+float totalMetal(std::vector<Spot> const & spots);
+
+} // namespace
@@ -0,0 +1,375 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "PixelKernels.h"
+#include "Resample.h"
+
+#include <cstring> // memcpy
+#include <cassert>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FLOBBY_X86
+#include <immintrin.h>
+#endif
+
+namespace PixelKernels
+{
+
+namespace
+{
+
+inline void rgb565ToRgbScalar(uint16_t const * src, uint8_t * dst, std::size_t n)
+{
+    for (std::size_t i=0; i<n; ++i)
+    {
+        uint16_t const p = src[i];
+        uint8_t const r5 = (p & 0xf800) >> 11;
+        uint8_t const g6 = (p & 0x07e0) >> 5;
+        uint8_t const b5 = p & 0x001f;
+
+        dst[0] = (r5 << 3) | (r5 >> 2);
+        dst[1] = (g6 << 2) | (g6 >> 4);
+        dst[2] = (b5 << 3) | (b5 >> 2);
+        dst += 3;
+    }
+}
+
+inline void grayToRgbScalar(uint8_t const * src, uint8_t * dst, std::size_t n, int channel)
+{
+    for (std::size_t i=0; i<n; ++i)
+    {
+        dst[0] = 0;
+        dst[1] = 0;
+        dst[2] = 0;
+        dst[channel] = src[i];
+        dst += 3;
+    }
+}
+
+inline std::size_t findScalar(uint8_t const * src, std::size_t n, uint8_t threshold, bool above)
+{
+    for (std::size_t i=0; i<n; ++i)
+    {
+        if ((src[i] > threshold) == above)
+        {
+            return i;
+        }
+    }
+    return n;
+}
+
+#ifdef FLOBBY_X86
+
+// The SIMD kernels write every pixel (or group of pixels) with a store that is wider than the pixel,
+// the extra bytes are overwritten by the next store. Each loop stops early enough to never write past
+// the end of dst, the remaining pixels are done with the scalar kernel.
+
+__attribute__((target("sse2")))
+inline void store32(uint8_t * dst, __m128i v)
+{
+    int32_t const val = _mm_cvtsi128_si32(v);
+    std::memcpy(dst, &val, 4);
+}
+
+// stores the 4 pixels [r,g,b,0] in v to dst, writes 13 bytes
+__attribute__((target("sse2")))
+inline void store4PixelsSse2(uint8_t * dst, __m128i v)
+{
+    store32(dst + 0, v);
+    store32(dst + 3, _mm_srli_si128(v, 4));
+    store32(dst + 6, _mm_srli_si128(v, 8));
+    store32(dst + 9, _mm_srli_si128(v, 12));
+}
+
+__attribute__((target("sse2")))
+void rgb565ToRgbSse2(uint16_t const * src, uint8_t * dst, std::size_t n)
+{
+    __m128i const mask5 = _mm_set1_epi16(0x1f);
+    __m128i const mask6 = _mm_set1_epi16(0x3f);
+
+    std::size_t i = 0;
+    for (; i+9 <= n; i += 8)
+    {
+        __m128i const p = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+
+        __m128i const r5 = _mm_srli_epi16(p, 11);
+        __m128i const g6 = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+        __m128i const b5 = _mm_and_si128(p, mask5);
+
+        __m128i const r8 = _mm_or_si128(_mm_slli_epi16(r5, 3), _mm_srli_epi16(r5, 2));
+        __m128i const g8 = _mm_or_si128(_mm_slli_epi16(g6, 2), _mm_srli_epi16(g6, 4));
+        __m128i const b8 = _mm_or_si128(_mm_slli_epi16(b5, 3), _mm_srli_epi16(b5, 2));
+
+        // 16 bit [r,g] and [b,0] interleaved to 32 bit [r,g,b,0]
+        __m128i const rg = _mm_or_si128(r8, _mm_slli_epi16(g8, 8));
+        store4PixelsSse2(dst + 3*i, _mm_unpacklo_epi16(rg, b8));
+        store4PixelsSse2(dst + 3*i + 12, _mm_unpackhi_epi16(rg, b8));
+    }
+    rgb565ToRgbScalar(src + i, dst + 3*i, n - i);
+}
+
+__attribute__((target("sse2")))
+void grayToRgbSse2(uint8_t const * src, uint8_t * dst, std::size_t n, int channel)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const shift = _mm_cvtsi32_si128(8*channel);
+
+    std::size_t i = 0;
+    for (; i+17 <= n; i += 16)
+    {
+        __m128i const g = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+        __m128i const lo = _mm_unpacklo_epi8(g, zero);
+        __m128i const hi = _mm_unpackhi_epi8(g, zero);
+
+        uint8_t * d = dst + 3*i;
+        store4PixelsSse2(d + 0, _mm_sll_epi32(_mm_unpacklo_epi16(lo, zero), shift));
+        store4PixelsSse2(d + 12, _mm_sll_epi32(_mm_unpackhi_epi16(lo, zero), shift));
+        store4PixelsSse2(d + 24, _mm_sll_epi32(_mm_unpacklo_epi16(hi, zero), shift));
+        store4PixelsSse2(d + 36, _mm_sll_epi32(_mm_unpackhi_epi16(hi, zero), shift));
+    }
+    grayToRgbScalar(src + i, dst + 3*i, n - i, channel);
+}
+
+// values above threshold are the non zero bytes of a saturated subtraction,
+// the search is mostly over long runs of zeros in metal maps
+__attribute__((target("sse2")))
+std::size_t findSse2(uint8_t const * src, std::size_t n, uint8_t threshold, bool above)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const t = _mm_set1_epi8(static_cast<char>(threshold));
+
+    std::size_t i = 0;
+    for (; i+16 <= n; i += 16)
+    {
+        __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+        int const notAbove = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(v, t), zero));
+        int const found = above ? (~notAbove & 0xffff) : notAbove;
+        if (found)
+        {
+            return i + __builtin_ctz(found);
+        }
+    }
+    return i + findScalar(src + i, n - i, threshold, above);
+}
+
+// stores the 4+4 pixels [r,g,b,x] in the two lanes of v to dst and dst+12, writes 28 bytes
+__attribute__((target("avx2")))
+inline void store8PixelsAvx2(uint8_t * dst, __m256i v, __m256i compact)
+{
+    __m256i const c = _mm256_shuffle_epi8(v, compact); // 12 bytes in each lane
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(c));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 12), _mm256_extracti128_si256(c, 1));
+}
+
+__attribute__((target("avx2")))
+void rgb565ToRgbAvx2(uint16_t const * src, uint8_t * dst, std::size_t n)
+{
+    __m256i const mask5 = _mm256_set1_epi16(0x1f);
+    __m256i const mask6 = _mm256_set1_epi16(0x3f);
+    __m256i const compact = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    std::size_t i = 0;
+    for (; i+18 <= n; i += 16)
+    {
+        __m256i const p = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+
+        __m256i const r5 = _mm256_srli_epi16(p, 11);
+        __m256i const g6 = _mm256_and_si256(_mm256_srli_epi16(p, 5), mask6);
+        __m256i const b5 = _mm256_and_si256(p, mask5);
+
+        __m256i const r8 = _mm256_or_si256(_mm256_slli_epi16(r5, 3), _mm256_srli_epi16(r5, 2));
+        __m256i const g8 = _mm256_or_si256(_mm256_slli_epi16(g6, 2), _mm256_srli_epi16(g6, 4));
+        __m256i const b8 = _mm256_or_si256(_mm256_slli_epi16(b5, 3), _mm256_srli_epi16(b5, 2));
+
+        // unpack works per 128 bit lane: lo has pixels 0-3 and 8-11, hi has pixels 4-7 and 12-15
+        __m256i const rg = _mm256_or_si256(r8, _mm256_slli_epi16(g8, 8));
+        __m256i const c0 = _mm256_shuffle_epi8(_mm256_unpacklo_epi16(rg, b8), compact);
+        __m256i const c1 = _mm256_shuffle_epi8(_mm256_unpackhi_epi16(rg, b8), compact);
+
+        uint8_t * d = dst + 3*i;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 0), _mm256_castsi256_si128(c0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 12), _mm256_castsi256_si128(c1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 24), _mm256_extracti128_si256(c0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 36), _mm256_extracti128_si256(c1, 1));
+    }
+    rgb565ToRgbScalar(src + i, dst + 3*i, n - i);
+}
+
+__attribute__((target("avx2")))
+void grayToRgbAvx2(uint8_t const * src, uint8_t * dst, std::size_t n, int channel)
+{
+    // 32 bit lanes holding one gray value each are compacted directly into the wanted channel
+    alignas(32) int8_t m[32];
+    for (int j=0; j<16; ++j)
+    {
+        int8_t const v = (j < 12 && j%3 == channel) ? static_cast<int8_t>(4*(j/3)) : -1;
+        m[j] = v;
+        m[j+16] = v;
+    }
+    __m256i const expand = _mm256_load_si256(reinterpret_cast<__m256i const*>(m));
+
+    std::size_t i = 0;
+    for (; i+18 <= n; i += 16)
+    {
+        __m256i const lo = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(src + i)));
+        __m256i const hi = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(src + i + 8)));
+
+        uint8_t * d = dst + 3*i;
+        store8PixelsAvx2(d, lo, expand);
+        store8PixelsAvx2(d + 24, hi, expand);
+    }
+    grayToRgbScalar(src + i, dst + 3*i, n - i, channel);
+}
+
+__attribute__((target("avx2")))
+std::size_t findAvx2(uint8_t const * src, std::size_t n, uint8_t threshold, bool above)
+{
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const t = _mm256_set1_epi8(static_cast<char>(threshold));
+
+    std::size_t i = 0;
+    for (; i+32 <= n; i += 32)
+    {
+        __m256i const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+        uint32_t const notAbove = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_subs_epu8(v, t), zero));
+        uint32_t const found = above ? ~notAbove : notAbove;
+        if (found)
+        {
+            return i + __builtin_ctz(found);
+        }
+    }
+    return i + findScalar(src + i, n - i, threshold, above);
+}
+
+#endif // FLOBBY_X86
+
+Isa detectIsa()
+{
+#ifdef FLOBBY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return ISA_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return ISA_SSE2;
+    }
+#endif
+    return ISA_SCALAR;
+}
+
+// requested isa limited to what the cpu supports
+inline Isa usableIsa(Isa isa)
+{
+    Isa const best = bestIsa();
+    return isa > best ? best : isa;
+}
+
+} // namespace
+
+Isa bestIsa()
+{
+    static Isa const isa = detectIsa();
+    return isa;
+}
+
+bool isaSupported(Isa isa)
+{
+    return isa <= bestIsa();
+}
+
+char const * isaName(Isa isa)
+{
+    switch (isa)
+    {
+    case ISA_SCALAR: return "scalar";
+    case ISA_SSE2: return "sse2";
+    case ISA_AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+void rgb565ToRgb(uint16_t const * src, uint8_t * dst, std::size_t n, Isa isa)
+{
+    switch (usableIsa(isa))
+    {
+#ifdef FLOBBY_X86
+    case ISA_AVX2:
+        rgb565ToRgbAvx2(src, dst, n);
+        break;
+    case ISA_SSE2:
+        rgb565ToRgbSse2(src, dst, n);
+        break;
+#endif
+    default:
+        rgb565ToRgbScalar(src, dst, n);
+        break;
+    }
+}
+
+void grayToRgb(uint8_t const * src, uint8_t * dst, std::size_t n, int channel, Isa isa)
+{
+    assert(channel >= 0 && channel <= 2);
+
+    switch (usableIsa(isa))
+    {
+#ifdef FLOBBY_X86
+    case ISA_AVX2:
+        grayToRgbAvx2(src, dst, n, channel);
+        break;
+    case ISA_SSE2:
+        grayToRgbSse2(src, dst, n, channel);
+        break;
+#endif
+    default:
+        grayToRgbScalar(src, dst, n, channel);
+        break;
+    }
+}
+
+std::size_t findAbove(uint8_t const * src, std::size_t n, uint8_t threshold, Isa isa)
+{
+    switch (usableIsa(isa))
+    {
+#ifdef FLOBBY_X86
+    case ISA_AVX2:
+        return findAvx2(src, n, threshold, true);
+    case ISA_SSE2:
+        return findSse2(src, n, threshold, true);
+#endif
+    default:
+        return findScalar(src, n, threshold, true);
+    }
+}
+
+std::size_t findNotAbove(uint8_t const * src, std::size_t n, uint8_t threshold, Isa isa)
+{
+    switch (usableIsa(isa))
+    {
+#ifdef FLOBBY_X86
+    case ISA_AVX2:
+        return findAvx2(src, n, threshold, false);
+    case ISA_SSE2:
+        return findSse2(src, n, threshold, false);
+#endif
+    default:
+        return findScalar(src, n, threshold, false);
+    }
+}
+
+void rgb565ToRgbResampled(uint16_t const * src, int w, int h, uint8_t * dst, int w2, int h2, Isa isa)
+{
+    AreaResampler resampler(w, h, 3, dst, w2, h2);
+
+    std::vector<uint8_t> row(w*3);
+    for (int y=0; y<h; ++y)
+    {
+        rgb565ToRgb(src + y*w, row.data(), w, isa);
+        resampler.addRow(row.data());
+    }
+}
+
+} // namespace
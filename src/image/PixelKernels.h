@@ -0,0 +1,40 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PixelKernels
+{
+
+// instruction set used by the kernels, Scalar is always available
+enum Isa
+{
+    ISA_SCALAR,
+    ISA_SSE2,
+    ISA_AVX2
+};
+
+Isa bestIsa(); // best instruction set supported by this cpu
+bool isaSupported(Isa isa);
+char const * isaName(Isa isa);
+
+// converts n RGB565 pixels (unitsync minimap format) to RGB888
+void rgb565ToRgb(uint16_t const * src, uint8_t * dst, std::size_t n, Isa isa = bestIsa());
+
+// expands n single component pixels (e.g. metal map) to RGB888,
+// value is put in channel (0=R, 1=G, 2=B) and the other channels are set to zero
+void grayToRgb(uint8_t const * src, uint8_t * dst, std::size_t n, int channel, Isa isa = bestIsa());
+
+// returns index of first of n values above threshold, n if none
+std::size_t findAbove(uint8_t const * src, std::size_t n, uint8_t threshold, Isa isa = bestIsa());
+
+// returns index of first of n values not above threshold, n if none
+std::size_t findNotAbove(uint8_t const * src, std::size_t n, uint8_t threshold, Isa isa = bestIsa());
+
+// converts a w x h RGB565 image to a w2 x h2 RGB888 image using area averaging,
+// conversion is done one source row at a time so the full size RGB888 image is never created
+void rgb565ToRgbResampled(uint16_t const * src, int w, int h, uint8_t * dst, int w2, int h2, Isa isa = bestIsa());
+
+} // namespace
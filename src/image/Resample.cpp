@@ -0,0 +1,133 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "Resample.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Source pixel s covers [s*w2, (s+1)*w2) and destination pixel x covers [x*w, (x+1)*w)
+// in a common integer coordinate system, the overlap length is the weight. The weights of
+// one destination pixel sum to w horizontally and h vertically, so no rounding errors
+// accumulate and the result does not depend on the scale ratio being an integer.
+
+AreaResampler::AreaResampler(int w, int h, int d, uint8_t * dst, int w2, int h2):
+    w_(w),
+    h_(h),
+    d_(d),
+    dst_(dst),
+    w2_(w2),
+    h2_(h2),
+    total_(static_cast<uint64_t>(w)*h),
+    spanFirst_(w2),
+    spanCount_(w2),
+    spanWeight_(w2),
+    y_(0),
+    openRow_(-1),
+    hsum_(w2*d),
+    acc_(w2*d)
+{
+    if (w <= 0 || h <= 0 || w2 <= 0 || h2 <= 0 || d <= 0)
+    {
+        throw std::invalid_argument("invalid resample dimensions");
+    }
+
+    for (int x=0; x<w2_; ++x)
+    {
+        int64_t const x0 = static_cast<int64_t>(x)*w_;
+        int64_t const x1 = x0 + w_;
+        int const first = static_cast<int>(x0 / w2_);
+        int const last = static_cast<int>((x1 - 1) / w2_);
+
+        spanFirst_[x] = first;
+        spanCount_[x] = last - first + 1;
+        spanWeight_[x] = static_cast<int>(weights_.size());
+        for (int s=first; s<=last; ++s)
+        {
+            int64_t const s0 = static_cast<int64_t>(s)*w2_;
+            int64_t const s1 = s0 + w2_;
+            weights_.push_back(static_cast<uint32_t>(std::min(s1, x1) - std::max(s0, x0)));
+        }
+    }
+}
+
+void AreaResampler::addRow(uint8_t const * row)
+{
+    if (y_ >= h_)
+    {
+        throw std::logic_error("too many rows added to resampler");
+    }
+
+    // horizontal pass
+    for (int x=0; x<w2_; ++x)
+    {
+        uint8_t const * src = row + spanFirst_[x]*d_;
+        uint32_t const * weight = &weights_[spanWeight_[x]];
+        uint32_t * sum = &hsum_[x*d_];
+        for (int c=0; c<d_; ++c)
+        {
+            sum[c] = 0;
+        }
+        for (int i=0; i<spanCount_[x]; ++i)
+        {
+            for (int c=0; c<d_; ++c)
+            {
+                sum[c] += src[c] * weight[i];
+            }
+            src += d_;
+        }
+    }
+
+    // vertical pass, the row contributes to one or more destination rows
+    int64_t const y0 = static_cast<int64_t>(y_)*h2_;
+    int64_t const y1 = y0 + h2_;
+    int const first = static_cast<int>(y0 / h_);
+    int const last = static_cast<int>((y1 - 1) / h_);
+    for (int r=first; r<=last; ++r)
+    {
+        if (r != openRow_)
+        {
+            std::fill(acc_.begin(), acc_.end(), 0);
+            openRow_ = r;
+        }
+
+        int64_t const r0 = static_cast<int64_t>(r)*h_;
+        int64_t const r1 = r0 + h_;
+        uint64_t const weight = static_cast<uint64_t>(std::min(y1, r1) - std::max(y0, r0));
+        for (std::size_t i=0; i<acc_.size(); ++i)
+        {
+            acc_[i] += hsum_[i] * weight;
+        }
+
+        if (r1 <= y1)
+        {
+            emitRow(r);
+            openRow_ = -1;
+        }
+    }
+
+    ++y_;
+}
+
+void AreaResampler::emitRow(int row)
+{
+    uint8_t * dst = dst_ + static_cast<std::size_t>(row)*w2_*d_;
+    for (std::size_t i=0; i<acc_.size(); ++i)
+    {
+        dst[i] = static_cast<uint8_t>((acc_[i] + total_/2) / total_);
+    }
+}
+
+namespace Resample
+{
+
+void area(uint8_t const * src, int w, int h, int d, uint8_t * dst, int w2, int h2)
+{
+    AreaResampler resampler(w, h, d, dst, w2, h2);
+    std::size_t const stride = static_cast<std::size_t>(w)*d;
+    for (int y=0; y<h; ++y)
+    {
+        resampler.addRow(src + y*stride);
+    }
+}
+
+} // namespace
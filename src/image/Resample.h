@@ -0,0 +1,49 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Area averaging (box filter) resampler for 8 bit images with d components per pixel.
+// Every destination pixel is the average of the source area it covers, weighted with
+// the covered fraction of each source pixel, this works for any down or up scale ratio.
+// Source rows are fed one at a time, destination rows are written as soon as they are complete.
+class AreaResampler
+{
+public:
+    AreaResampler(int w, int h, int d, uint8_t * dst, int w2, int h2);
+
+    void addRow(uint8_t const * row); // call h times with rows of w*d bytes
+
+private:
+    int const w_;
+    int const h_;
+    int const d_;
+    uint8_t * const dst_;
+    int const w2_;
+    int const h2_;
+    uint64_t const total_; // sum of weights for one destination pixel (w*h)
+
+    // horizontal spans, destination column x uses source columns
+    // spanFirst_[x] ... spanFirst_[x]+spanCount_[x]-1 with weights starting at weights_[spanWeight_[x]]
+    std::vector<int> spanFirst_;
+    std::vector<int> spanCount_;
+    std::vector<int> spanWeight_;
+    std::vector<uint32_t> weights_;
+
+    int y_; // next source row
+    int openRow_; // destination row in acc_ not yet complete, -1 if none
+    std::vector<uint32_t> hsum_; // current source row resampled horizontally
+    std::vector<uint64_t> acc_;
+
+    void emitRow(int row);
+};
+
+namespace Resample
+{
+
+// resamples w x h x d image to w2 x h2 x d image
+void area(uint8_t const * src, int w, int h, int d, uint8_t * dst, int w2, int h2);
+
+} // namespace
@@ -0,0 +1,209 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "BattleFilter.h"
+#include "Battle.h"
+
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+
+bool parseRange(std::string const & str, int & min, int & max)
+{
+    if (str.empty() || str == "-")
+    {
+        return false;
+    }
+
+    std::size_t const dash = str.find('-');
+    std::string const minStr = str.substr(0, dash);
+    std::string const maxStr = dash == std::string::npos ? minStr : str.substr(dash + 1);
+
+    char * end;
+    min = minStr.empty() ? INT_MIN : std::strtol(minStr.c_str(), &end, 10);
+    if (!minStr.empty() && *end != 0) return false;
+    max = maxStr.empty() ? INT_MAX : std::strtol(maxStr.c_str(), &end, 10);
+    if (!maxStr.empty() && *end != 0) return false;
+
+    return min <= max;
+}
+
+// "zero, nota" is one term like "zero,nota"
+std::string joinAlternatives(std::string const & text)
+{
+    std::string res;
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        char const c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            std::size_t next = i;
+            while (next < text.size() && std::isspace(static_cast<unsigned char>(text[next]))) ++next;
+            bool const afterComma = !res.empty() && res.back() == ',';
+            bool const beforeComma = next < text.size() && text[next] == ',';
+            if (!afterComma && !beforeComma)
+            {
+                res += ' ';
+            }
+            i = next - 1;
+        }
+        else
+        {
+            res += c;
+        }
+    }
+    return res;
+}
+
+} // namespace
+
+BattleFilter::BattleFilter(HasContent hasMap, HasContent hasGame):
+    hasMap_(hasMap),
+    hasGame_(hasGame)
+{
+}
+
+void BattleFilter::set(std::string const & text, int minPlayers, bool installed)
+{
+    static struct { char const * prefix_; TermType type_; } const textTypes[] = {
+        { "game:", TT_GAME },
+        { "map:", TT_MAP },
+        { "engine:", TT_ENGINE },
+        { "title:", TT_TITLE },
+    };
+    static struct { char const * word_; TermType type_; } const flagTypes[] = {
+        { "is:running", TT_RUNNING },
+        { "is:passworded", TT_PASSWORDED },
+        { "is:locked", TT_LOCKED },
+        { "has:map", TT_HAS_MAP },
+        { "has:game", TT_HAS_GAME },
+    };
+
+    terms_.clear();
+
+    std::istringstream iss(joinAlternatives(boost::algorithm::to_lower_copy(text)));
+    std::string word;
+    while (iss >> word)
+    {
+        Term term = { TT_GAME, false, {}, 0, 0 };
+        if (word[0] == '-')
+        {
+            term.negate_ = true;
+            word.erase(0, 1);
+        }
+
+        bool known = false;
+        for (auto const & ft : flagTypes)
+        {
+            if (word == ft.word_)
+            {
+                term.type_ = ft.type_;
+                known = true;
+                break;
+            }
+        }
+
+        if (!known && boost::algorithm::starts_with(word, "players:"))
+        {
+            // incomplete ranges, e.g. while typing, are ignored
+            if (!parseRange(word.substr(std::strlen("players:")), term.min_, term.max_))
+            {
+                continue;
+            }
+            term.type_ = TT_PLAYERS;
+            known = true;
+        }
+
+        if (!known)
+        {
+            for (auto const & tt : textTypes)
+            {
+                if (boost::algorithm::starts_with(word, tt.prefix_))
+                {
+                    term.type_ = tt.type_;
+                    word.erase(0, std::strlen(tt.prefix_));
+                    break;
+                }
+            }
+            boost::algorithm::split(term.texts_, word, boost::is_any_of(","));
+            term.texts_.erase(std::remove(term.texts_.begin(), term.texts_.end(), std::string()), term.texts_.end());
+            if (term.texts_.empty())
+            {
+                continue;
+            }
+        }
+        terms_.push_back(term);
+    }
+
+    if (minPlayers > 0)
+    {
+        terms_.push_back(Term { TT_PLAYERS, false, {}, minPlayers, INT_MAX });
+    }
+    if (installed)
+    {
+        terms_.push_back(Term { TT_HAS_MAP, false, {}, 0, 0 });
+        terms_.push_back(Term { TT_HAS_GAME, false, {}, 0, 0 });
+    }
+
+    std::stable_sort(terms_.begin(), terms_.end(),
+                     [](Term const & a, Term const & b) { return a.type_ < b.type_; });
+}
+
+bool BattleFilter::match(Battle const & battle) const
+{
+    for (auto const & term : terms_)
+    {
+        if (matchTerm(term, battle) == term.negate_)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BattleFilter::matchTerm(Term const & term, Battle const & battle) const
+{
+    switch (term.type_)
+    {
+    case TT_RUNNING:
+        return battle.running();
+    case TT_PASSWORDED:
+        return battle.passworded();
+    case TT_LOCKED:
+        return battle.locked();
+    case TT_PLAYERS:
+        return battle.playerCount() >= term.min_ && battle.playerCount() <= term.max_;
+    case TT_GAME:
+        return contains(battle.modName(), term.texts_);
+    case TT_MAP:
+        return contains(battle.mapName(), term.texts_);
+    case TT_ENGINE:
+        return contains(battle.engineVersionLong(), term.texts_);
+    case TT_TITLE:
+        return contains(battle.title(), term.texts_) || contains(battle.founder(), term.texts_);
+    case TT_HAS_MAP:
+        return hasMap_(battle.mapName(), battle.mapHash());
+    case TT_HAS_GAME:
+        return hasGame_(battle.modName(), battle.modHash());
+    }
+    return false;
+}
+
+bool BattleFilter::contains(std::string const & str, std::vector<std::string> const & texts)
+{
+    auto const equal = [](char c, char lower) { return std::tolower(static_cast<unsigned char>(c)) == lower; };
+    for (auto const & text : texts)
+    {
+        if (std::search(str.begin(), str.end(), text.begin(), text.end(), equal) != str.end())
+        {
+            return true;
+        }
+    }
+    return false;
+}
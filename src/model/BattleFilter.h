@@ -0,0 +1,50 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class Battle;
+
+// Filter for the battle list, the filter text is parsed once in set() so match() is cheap and does not allocate.
+// Filter text is terms separated by space, a battle must match all of them, a term starting with '-' must not match:
+//   text             case insensitive substring of game name, alternatives separated by ',' e.g. "zero,nota"
+//   game:text        same as text
+//   map:text
+//   engine:text
+//   title:text       title or host
+//   players:<range>  number of players, range is "a-b", "a-", "-b" or "a"
+//   is:running, is:passworded, is:locked
+//   has:map, has:game
+// Unknown or incomplete terms are ignored.
+class BattleFilter
+{
+public:
+    typedef std::function<bool (std::string const & name, unsigned int checksum)> HasContent;
+    BattleFilter(HasContent hasMap, HasContent hasGame);
+
+    // minPlayers and installed (has:map has:game) are added to the terms of text
+    void set(std::string const & text, int minPlayers = 0, bool installed = false);
+    bool match(Battle const & battle) const;
+
+private:
+    // in order of evaluation, cheap terms first
+    enum TermType { TT_RUNNING, TT_PASSWORDED, TT_LOCKED, TT_PLAYERS, TT_GAME, TT_MAP, TT_ENGINE, TT_TITLE, TT_HAS_MAP, TT_HAS_GAME };
+    struct Term
+    {
+        TermType type_;
+        bool negate_;
+        std::vector<std::string> texts_; // lower case alternatives for text terms
+        int min_;
+        int max_;
+    };
+
+    HasContent hasMap_;
+    HasContent hasGame_;
+    std::vector<Term> terms_;
+
+    bool matchTerm(Term const & term, Battle const & battle) const;
+    static bool contains(std::string const & str, std::vector<std::string> const & texts); // any of lower case texts
+};
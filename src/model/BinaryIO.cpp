@@ -0,0 +1,69 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "BinaryIO.h"
+
+#include <stdexcept>
+#include <cstring>
+
+namespace BinaryIO
+{
+
+void putU32(std::string & out, uint32_t val)
+{
+    out.append(reinterpret_cast<char const *>(&val), sizeof(val));
+}
+
+void putF32(std::string & out, float val)
+{
+    out.append(reinterpret_cast<char const *>(&val), sizeof(val));
+}
+
+void putString(std::string & out, std::string const & str)
+{
+    putU32(out, str.size());
+    out.append(str);
+}
+
+Reader::Reader(char const * data, std::size_t size, std::string const & typeName):
+    p_(data),
+    end_(data + size),
+    typeName_(typeName)
+{
+}
+
+uint32_t Reader::u32()
+{
+    uint32_t val;
+    need(sizeof(val));
+    std::memcpy(&val, p_, sizeof(val));
+    p_ += sizeof(val);
+    return val;
+}
+
+float Reader::f32()
+{
+    float val;
+    need(sizeof(val));
+    std::memcpy(&val, p_, sizeof(val));
+    p_ += sizeof(val);
+    return val;
+}
+
+std::string Reader::string()
+{
+    std::size_t const size = u32();
+    need(size);
+    std::string const str(p_, size);
+    p_ += size;
+    return str;
+}
+
+void Reader::need(std::size_t size)
+{
+    if (static_cast<std::size_t>(end_ - p_) < size)
+    {
+        throw std::runtime_error(typeName_ + " data truncated");
+    }
+}
+
+}; // namespace
@@ -0,0 +1,36 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Helpers for the binary records of MapInfo and GameInfo stored in the cache pack files.
+// Values are written in host byte order, the cache is not shared between machines.
+namespace BinaryIO
+{
+
+void putU32(std::string & out, uint32_t val);
+void putF32(std::string & out, float val);
+void putString(std::string & out, std::string const & str); // size prefixed
+
+// reads values written by the put functions, throws when data is truncated
+class Reader
+{
+public:
+    Reader(char const * data, std::size_t size, std::string const & typeName); // typeName for error message
+
+    uint32_t u32();
+    float f32();
+    std::string string();
+
+private:
+    char const * p_;
+    char const * const end_;
+    std::string const typeName_;
+
+    void need(std::size_t size);
+};
+
+}; // namespace
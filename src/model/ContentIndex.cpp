@@ -0,0 +1,36 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "ContentIndex.h"
+
+void ContentIndex::clear()
+{
+    maps_.clear();
+    games_.clear();
+}
+
+void ContentIndex::addMap(std::string const & name, unsigned int checksum)
+{
+    maps_[name] = checksum;
+}
+
+void ContentIndex::addGame(std::string const & name, unsigned int checksum)
+{
+    games_[name] = checksum;
+}
+
+unsigned int ContentIndex::mapChecksum(std::string const & name) const
+{
+    auto const it = maps_.find(name);
+    return it == maps_.end() ? 0 : it->second;
+}
+
+bool ContentIndex::knowsGame(std::string const & name) const
+{
+    return games_.count(name) > 0;
+}
+
+unsigned int ContentIndex::gameChecksum(std::string const & name) const
+{
+    auto const it = games_.find(name);
+    return it == games_.end() ? 0 : it->second;
+}
@@ -0,0 +1,31 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+// Installed maps and games with their checksums, rebuilt by Model on refresh.
+// Maps are added from the unitsync map list, games are added when first looked up since unitsync
+// only finds games by their full name. All lookups are hash lookups.
+class ContentIndex
+{
+public:
+    void clear();
+
+    void addMap(std::string const & name, unsigned int checksum);
+    void addGame(std::string const & name, unsigned int checksum); // checksum 0 records a missing game
+
+    unsigned int mapChecksum(std::string const & name) const; // returns 0 if not installed
+    bool knowsGame(std::string const & name) const; // true if addGame was called for name
+    unsigned int gameChecksum(std::string const & name) const; // returns 0 if not installed or not known
+
+    std::size_t mapCount() const { return maps_.size(); }
+
+    // true if installed (have != 0) and matches the wanted checksum, wanted 0 matches any
+    static bool matches(unsigned int have, unsigned int wanted) { return have != 0 && (wanted == 0 || wanted == have); }
+
+private:
+    std::unordered_map<std::string, unsigned int> maps_;
+    std::unordered_map<std::string, unsigned int> games_;
+};
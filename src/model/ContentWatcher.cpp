@@ -0,0 +1,178 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "ContentWatcher.h"
+
+#include "log/Log.h"
+
+#include <boost/algorithm/string.hpp>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+
+// archives are written by the downloaders and then moved into place, deletions are also picked up
+uint32_t const fileEvents = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE;
+
+std::string withSlash(std::string const & dir)
+{
+    return (!dir.empty() && dir.back() == '/') ? dir : dir + "/";
+}
+
+} // namespace
+
+ContentWatcher::ContentWatcher():
+    fd_(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+    if (fd_ < 0)
+    {
+        LOG(WARNING) << "inotify not available, new content is found on reload only: " << std::strerror(errno);
+    }
+}
+
+ContentWatcher::~ContentWatcher()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+}
+
+bool ContentWatcher::isArchive(std::string const & fileName)
+{
+    if (fileName.empty() || fileName[0] == '.')
+    {
+        return false;
+    }
+    std::string const name = boost::algorithm::to_lower_copy(fileName);
+    for (char const * ext : { ".sd7", ".sdz", ".sdd", ".sdp" })
+    {
+        if (boost::algorithm::ends_with(name, ext))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ContentWatcher::isContentDir(std::string const & name)
+{
+    return name == "maps" || name == "games" || name == "packages";
+}
+
+bool ContentWatcher::isDataDir(std::string const & dir) const
+{
+    return std::find(dataDirs_.begin(), dataDirs_.end(), dir) != dataDirs_.end();
+}
+
+void ContentWatcher::watch(std::vector<std::string> const & dataDirs)
+{
+    if (fd_ < 0)
+    {
+        return;
+    }
+
+    for (auto const & pair : watches_)
+    {
+        ::inotify_rm_watch(fd_, pair.first);
+    }
+    watches_.clear();
+    dataDirs_.clear();
+
+    for (auto const & dataDir : dataDirs)
+    {
+        std::string const dir = withSlash(dataDir);
+        dataDirs_.push_back(dir);
+
+        // data dir is watched for content dirs created later
+        addWatch(dir);
+        for (char const * sub : { "maps", "games", "packages" })
+        {
+            struct stat st;
+            std::string const subDir = dir + sub + "/";
+            if (::stat(subDir.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            {
+                addWatch(subDir);
+            }
+        }
+    }
+}
+
+void ContentWatcher::addWatch(std::string const & dir)
+{
+    int const wd = ::inotify_add_watch(fd_, dir.c_str(), fileEvents | IN_ONLYDIR);
+    if (wd < 0)
+    {
+        LOG(WARNING) << "failed to watch " << dir << ": " << std::strerror(errno);
+        return;
+    }
+    watches_[wd] = dir;
+    LOG(DEBUG) << "watching " << dir;
+}
+
+std::vector<std::string> ContentWatcher::readChanges()
+{
+    std::vector<std::string> changes;
+    if (fd_ < 0)
+    {
+        return changes;
+    }
+
+    alignas(inotify_event) char buf[16*1024];
+    while (true)
+    {
+        ssize_t const len = ::read(fd_, buf, sizeof(buf));
+        if (len <= 0)
+        {
+            break; // EAGAIN when all events are read
+        }
+
+        for (char const * p = buf; p < buf + len; )
+        {
+            inotify_event const * event = reinterpret_cast<inotify_event const *>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                // events lost, report a change so everything is rescanned
+                LOG(WARNING) << "inotify queue overflow";
+                changes.push_back(std::string());
+                continue;
+            }
+
+            auto const it = watches_.find(event->wd);
+            if (it == watches_.end() || event->len == 0)
+            {
+                continue;
+            }
+            std::string const & dir = it->second;
+            std::string const name(event->name);
+
+            if (isDataDir(dir))
+            {
+                // new maps, games or packages directory
+                if ((event->mask & (IN_CREATE | IN_MOVED_TO)) && (event->mask & IN_ISDIR) && isContentDir(name))
+                {
+                    addWatch(dir + name + "/");
+                }
+                continue;
+            }
+
+            // files are reported when written, directories (.sdd) when created
+            bool const isDir = event->mask & IN_ISDIR;
+            if ((event->mask & IN_CREATE) && !isDir)
+            {
+                continue;
+            }
+            if (isArchive(name))
+            {
+                changes.push_back(dir + name);
+            }
+        }
+    }
+    return changes;
+}
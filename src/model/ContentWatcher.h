@@ -0,0 +1,34 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Watches the maps, games and packages directories of the spring data directories with inotify
+// so new or removed archives can be picked up without a manual reload.
+// fd() is meant to be polled by the ui event loop, readChanges() does not block.
+class ContentWatcher
+{
+public:
+    ContentWatcher(); // fd() is -1 if inotify is not available
+    virtual ~ContentWatcher();
+
+    int fd() const { return fd_; }
+
+    void watch(std::vector<std::string> const & dataDirs); // replaces directories watched
+    // returns paths of archives added or removed since last call, an empty path means events were lost
+    std::vector<std::string> readChanges();
+
+    static bool isArchive(std::string const & fileName);
+
+private:
+    int fd_;
+    std::map<int, std::string> watches_; // watch descriptor -> directory
+    std::vector<std::string> dataDirs_;
+
+    void addWatch(std::string const & dir);
+    bool isDataDir(std::string const & dir) const;
+    static bool isContentDir(std::string const & name); // maps, games or packages
+};
@@ -0,0 +1,178 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "GameInfo.h"
+#include "BinaryIO.h"
+
+#include <boost/algorithm/string.hpp>
+#include <stdexcept>
+
+uint32_t const GameInfo::binaryVersion_ = 2; // 2 added options
+
+void GameInfo::serialize(std::string & out) const
+{
+    using namespace BinaryIO;
+
+    putU32(out, binaryVersion_);
+    putString(out, name_);
+    putU32(out, checksum_);
+
+    putU32(out, ais_.size());
+    for (auto const & ai : ais_)
+    {
+        putString(out, ai.name_);
+        putU32(out, ai.info_.size());
+        for (auto const & pair : ai.info_)
+        {
+            putString(out, pair.first);
+            putString(out, pair.second);
+        }
+    }
+
+    putU32(out, sideNames_.size());
+    for (auto const & side : sideNames_)
+    {
+        putString(out, side);
+    }
+
+    putU32(out, options_.size());
+    for (auto const & option : options_)
+    {
+        putString(out, option.key_);
+        putString(out, option.name_);
+        putString(out, option.section_);
+        putString(out, option.desc_);
+        putU32(out, option.type_);
+        putString(out, option.default_);
+        putU32(out, option.listItems_.size());
+        for (auto const & item : option.listItems_)
+        {
+            putString(out, item.first);
+            putString(out, item.second);
+        }
+    }
+}
+
+void GameInfo::unserialize(char const * data, std::size_t size)
+{
+    using namespace BinaryIO;
+
+    Reader reader(data, size, "GameInfo");
+
+    uint32_t const version = reader.u32();
+    if (version != binaryVersion_ && version != 1)
+    {
+        throw std::runtime_error("GameInfo binary version mismatch");
+    }
+
+    GameInfo gi;
+    gi.name_ = reader.string();
+    gi.checksum_ = reader.u32();
+
+    uint32_t const aiCount = reader.u32();
+    for (uint32_t i=0; i<aiCount; ++i)
+    {
+        AI ai;
+        ai.name_ = reader.string();
+        uint32_t const infoCount = reader.u32();
+        for (uint32_t j=0; j<infoCount; ++j)
+        {
+            std::string const key = reader.string();
+            ai.info_[key] = reader.string();
+        }
+        gi.ais_.push_back(ai);
+    }
+
+    uint32_t const sideCount = reader.u32();
+    for (uint32_t i=0; i<sideCount; ++i)
+    {
+        gi.sideNames_.push_back(reader.string());
+    }
+
+    gi.hasOptions_ = (version >= 2);
+    if (gi.hasOptions_)
+    {
+        uint32_t const optionCount = reader.u32();
+        for (uint32_t i=0; i<optionCount; ++i)
+        {
+            Option option;
+            option.key_ = reader.string();
+            option.name_ = reader.string();
+            option.section_ = reader.string();
+            option.desc_ = reader.string();
+            option.type_ = static_cast<OptionType>(reader.u32());
+            option.default_ = reader.string();
+            uint32_t const itemCount = reader.u32();
+            for (uint32_t j=0; j<itemCount; ++j)
+            {
+                std::string const key = reader.string();
+                option.listItems_.push_back(std::make_pair(key, reader.string()));
+            }
+            gi.options_.push_back(option);
+        }
+    }
+
+    *this = gi;
+}
+
+GameInfo::Option const * GameInfo::findOption(std::string const & key) const
+{
+    std::string const lowerKey = boost::algorithm::to_lower_copy(key);
+    for (auto const & option : options_)
+    {
+        if (option.key_ == lowerKey)
+        {
+            return &option;
+        }
+    }
+    return 0;
+}
+
+std::string GameInfo::Option::valueText(std::string const & value) const
+{
+    if (type_ == OT_LIST)
+    {
+        for (auto const & item : listItems_)
+        {
+            if (boost::algorithm::iequals(item.first, value))
+            {
+                return item.second;
+            }
+        }
+    }
+    return value;
+}
+
+bool GameInfo::operator==(GameInfo const & gi) const
+{
+    if (ais_.size() != gi.ais_.size())
+    {
+        return false;
+    }
+    for (std::size_t i=0; i<ais_.size(); ++i)
+    {
+        if (ais_[i].name_ != gi.ais_[i].name_ || ais_[i].info_ != gi.ais_[i].info_)
+        {
+            return false;
+        }
+    }
+
+    if (options_.size() != gi.options_.size())
+    {
+        return false;
+    }
+    for (std::size_t i=0; i<options_.size(); ++i)
+    {
+        Option const & a = options_[i];
+        Option const & b = gi.options_[i];
+        if (a.key_ != b.key_ || a.name_ != b.name_ || a.section_ != b.section_ || a.desc_ != b.desc_ ||
+            a.type_ != b.type_ || a.default_ != b.default_ || a.listItems_ != b.listItems_)
+        {
+            return false;
+        }
+    }
+
+    return name_ == gi.name_ &&
+           checksum_ == gi.checksum_ &&
+           sideNames_ == gi.sideNames_ &&
+           hasOptions_ == gi.hasOptions_;
+}
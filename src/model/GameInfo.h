@@ -0,0 +1,52 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include "AI.h"
+
+#include <utility>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// game metadata that needs the game archives mounted in unitsync, cached by Cache
+class GameInfo
+{
+public:
+    GameInfo(): checksum_(0), hasOptions_(false) {}
+
+    // game option (modoptions.lua), types are the unitsync option types
+    enum OptionType { OT_ERROR = 0, OT_BOOL = 1, OT_LIST = 2, OT_NUMBER = 3, OT_STRING = 4, OT_SECTION = 5 };
+    struct Option
+    {
+        Option(): type_(OT_ERROR) {}
+
+        std::string key_; // lower case
+        std::string name_;
+        std::string section_;
+        std::string desc_;
+        OptionType type_;
+        std::string default_; // bool "0"/"1", number formatted, list item key
+        std::vector<std::pair<std::string, std::string> > listItems_; // key, name
+
+        std::string valueText(std::string const & value) const; // list item name for list options
+    };
+
+    std::string name_;
+    unsigned int checksum_;
+    std::vector<AI> ais_;
+    std::vector<std::string> sideNames_;
+    bool hasOptions_; // false for entries stored by older versions
+    std::vector<Option> options_;
+
+    Option const * findOption(std::string const & key) const; // case insensitive, returns 0 if not found
+
+    void serialize(std::string & out) const; // appends to out
+    void unserialize(char const * data, std::size_t size); // throws on error
+
+    bool operator==(GameInfo const & gi) const;
+
+private:
+    static uint32_t const binaryVersion_;
+};
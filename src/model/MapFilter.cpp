@@ -0,0 +1,217 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "MapFilter.h"
+#include "MapInfo.h"
+
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <sstream>
+
+MapFilter::MapFilter():
+    valid_(false)
+{
+}
+
+void MapFilter::clear()
+{
+    entries_.clear();
+    matches_.clear();
+    terms_.clear();
+    valid_ = false;
+}
+
+void MapFilter::add(std::string const & name, MapInfo const * mapInfo)
+{
+    Entry entry;
+    entry.text_ = boost::algorithm::to_lower_copy(name);
+    setInfo(entry, mapInfo);
+    entries_.push_back(entry);
+    valid_ = false;
+}
+
+void MapFilter::update(std::size_t index, MapInfo const * mapInfo)
+{
+    Entry & entry = entries_.at(index);
+    entry.text_.erase(std::min(entry.text_.find('\n'), entry.text_.size())); // author
+    setInfo(entry, mapInfo);
+    valid_ = false; // entry may match now
+}
+
+void MapFilter::setInfo(Entry & entry, MapInfo const * mapInfo)
+{
+    entry.hasInfo_ = mapInfo != 0;
+    entry.width_ = 0;
+    entry.height_ = 0;
+    entry.windMin_ = 0;
+    entry.windMax_ = 0;
+    entry.tidal_ = 0;
+    entry.gravity_ = 0;
+    entry.metalSpots_ = -1;
+    if (mapInfo)
+    {
+        entry.text_ += '\n' + boost::algorithm::to_lower_copy(mapInfo->author_);
+        entry.width_ = mapInfo->width_/512;
+        entry.height_ = mapInfo->height_/512;
+        entry.windMin_ = mapInfo->windMin_;
+        entry.windMax_ = mapInfo->windMax_;
+        entry.tidal_ = mapInfo->tidalStrength_;
+        entry.gravity_ = mapInfo->gravity_;
+        if (mapInfo->hasMetalSpots_)
+        {
+            entry.metalSpots_ = mapInfo->metalSpots_.size();
+        }
+    }
+}
+
+std::vector<int> const & MapFilter::filter(std::string const & text)
+{
+    Terms const terms = parse(text);
+
+    if (valid_ && narrows(terms_, terms))
+    {
+        // only previous matches can match
+        matches_.erase(std::remove_if(matches_.begin(), matches_.end(),
+                                      [this, &terms](int i) { return !match(entries_[i], terms); }),
+                       matches_.end());
+    }
+    else
+    {
+        matches_.clear();
+        for (int i=0; i<static_cast<int>(entries_.size()); ++i)
+        {
+            if (match(entries_[i], terms))
+            {
+                matches_.push_back(i);
+            }
+        }
+    }
+
+    terms_ = terms;
+    valid_ = true;
+    return matches_;
+}
+
+bool MapFilter::Term::operator==(Term const & t) const
+{
+    return type_ == t.type_ && text_ == t.text_ && min_ == t.min_ && max_ == t.max_;
+}
+
+MapFilter::Terms MapFilter::parse(std::string const & text)
+{
+    static struct { char const * prefix_; TermType type_; } const rangeTypes[] = {
+        { "size:", TT_SIZE },
+        { "wind:", TT_WIND },
+        { "tidal:", TT_TIDAL },
+        { "gravity:", TT_GRAVITY },
+        { "metal:", TT_METAL },
+    };
+
+    Terms terms;
+    std::istringstream iss(boost::algorithm::to_lower_copy(text));
+    std::string word;
+    while (iss >> word)
+    {
+        Term term = { TT_TEXT, word, 0, 0 };
+        for (auto const & rt : rangeTypes)
+        {
+            if (boost::algorithm::starts_with(word, rt.prefix_))
+            {
+                term.type_ = rt.type_;
+                break;
+            }
+        }
+
+        if (term.type_ != TT_TEXT)
+        {
+            // incomplete ranges, e.g. while typing, are ignored
+            std::string const range = word.substr(word.find(':') + 1);
+            if (!parseRange(range, term.min_, term.max_))
+            {
+                continue;
+            }
+            term.text_.clear();
+        }
+        terms.push_back(term);
+    }
+    return terms;
+}
+
+bool MapFilter::parseRange(std::string const & str, int & min, int & max)
+{
+    if (str.empty() || str == "-")
+    {
+        return false;
+    }
+
+    std::size_t const dash = str.find('-');
+    std::string const minStr = str.substr(0, dash);
+    std::string const maxStr = dash == std::string::npos ? minStr : str.substr(dash + 1);
+
+    char * end;
+    min = minStr.empty() ? INT_MIN : std::strtol(minStr.c_str(), &end, 10);
+    if (!minStr.empty() && *end != 0) return false;
+    max = maxStr.empty() ? INT_MAX : std::strtol(maxStr.c_str(), &end, 10);
+    if (!maxStr.empty() && *end != 0) return false;
+
+    return min <= max;
+}
+
+bool MapFilter::narrows(Terms const & prev, Terms const & next)
+{
+    // every previous term must be kept or narrowed, e.g. a word extended
+    if (next.size() < prev.size())
+    {
+        return false;
+    }
+    for (std::size_t i=0; i<prev.size(); ++i)
+    {
+        if (prev[i] == next[i])
+        {
+            continue;
+        }
+        if (prev[i].type_ != TT_TEXT || next[i].type_ != TT_TEXT || next[i].text_.find(prev[i].text_) == std::string::npos)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MapFilter::match(Entry const & entry, Terms const & terms)
+{
+    for (auto const & term : terms)
+    {
+        if (term.type_ == TT_TEXT)
+        {
+            if (entry.text_.find(term.text_) == std::string::npos) return false;
+            continue;
+        }
+
+        if (!entry.hasInfo_) return false;
+
+        switch (term.type_)
+        {
+        case TT_SIZE:
+            if (entry.width_ < term.min_ || entry.width_ > term.max_ ||
+                entry.height_ < term.min_ || entry.height_ > term.max_) return false;
+            break;
+        case TT_WIND:
+            if (entry.windMax_ < term.min_ || entry.windMin_ > term.max_) return false;
+            break;
+        case TT_TIDAL:
+            if (entry.tidal_ < term.min_ || entry.tidal_ > term.max_) return false;
+            break;
+        case TT_GRAVITY:
+            if (entry.gravity_ < term.min_ || entry.gravity_ > term.max_) return false;
+            break;
+        case TT_METAL:
+            if (entry.metalSpots_ < 0 || entry.metalSpots_ < term.min_ || entry.metalSpots_ > term.max_) return false;
+            break;
+        case TT_TEXT:
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+class MapInfo;
+
+// Filter for the maps window, the maps are indexed once so each change of the filter text is cheap.
+// Filter text is words and ranges separated by space, a map must match all of them:
+//   word          case insensitive substring of map name or author
+//   size:<range>  map width and height (in size units, 512 elmos)
+//   wind:<range>  map wind min-max overlaps range
+//   tidal:<range>
+//   gravity:<range>
+//   metal:<range> number of metal spots
+// A range is "a-b", "a-", "-b" or "a". Range filters do not match maps without map info.
+class MapFilter
+{
+public:
+    MapFilter();
+
+    void clear();
+    void add(std::string const & name, MapInfo const * mapInfo); // mapInfo 0 if not available
+    void update(std::size_t index, MapInfo const * mapInfo); // map info cached after add
+    std::size_t size() const { return entries_.size(); }
+
+    // returns indexes (in add order) of matching maps, when text only narrows the previous
+    // filter text only the previous matches are checked
+    std::vector<int> const & filter(std::string const & text);
+
+private:
+    struct Entry
+    {
+        std::string text_; // lower case name and author separated by '\n'
+        bool hasInfo_;
+        int width_;
+        int height_;
+        int windMin_;
+        int windMax_;
+        int tidal_;
+        int gravity_;
+        int metalSpots_; // -1 if not known
+    };
+
+    enum TermType { TT_TEXT, TT_SIZE, TT_WIND, TT_TIDAL, TT_GRAVITY, TT_METAL };
+    struct Term
+    {
+        TermType type_;
+        std::string text_; // lower case for TT_TEXT
+        int min_;
+        int max_;
+
+        bool operator==(Term const & t) const;
+    };
+    typedef std::vector<Term> Terms;
+
+    std::vector<Entry> entries_;
+    Terms terms_; // of last filter
+    std::vector<int> matches_; // of last filter
+    bool valid_; // matches_ is valid for terms_
+
+    static void setInfo(Entry & entry, MapInfo const * mapInfo); // text_ is lower case name
+    static Terms parse(std::string const & text);
+    static bool parseRange(std::string const & str, int & min, int & max);
+    static bool narrows(Terms const & prev, Terms const & next);
+    static bool match(Entry const & entry, Terms const & terms);
+};
@@ -1,16 +1,19 @@
 // This file is part of flobby (GPL v2 or later), see the LICENSE file
 
 #include "MapInfo.h"
+#include "BinaryIO.h"
 #include "UnitSync.h"
 #include <iostream>
 #include <stdexcept>
 
 std::string const MapInfo::version_ = "MapInfo_1";
+uint32_t const MapInfo::binaryVersion_ = 3; // 3 added metal spots
 
 MapInfo::MapInfo(UnitSync & unitSync, int index):
     name_( nullToEmpty(unitSync.GetMapName(index)) ),
     fileName_( nullToEmpty(unitSync.GetMapFileName(index)) ),
-    checksum_(unitSync.GetMapChecksum(index))
+    checksum_(unitSync.GetMapChecksum(index)),
+    hasMetalSpots_(false)
 {
     int const mapInfos = unitSync.GetMapInfoCount(index);
     for (int i=0; i<mapInfos; ++i)
@@ -96,6 +99,75 @@ void MapInfo::unserialize(std::istream & is)
     is >> gravity_;
 }
 
+void MapInfo::serialize(std::string & out) const
+{
+    using namespace BinaryIO;
+
+    putU32(out, binaryVersion_);
+    putString(out, name_);
+    putString(out, fileName_);
+    putString(out, description_);
+    putString(out, author_);
+    putU32(out, checksum_);
+    putU32(out, width_);
+    putU32(out, height_);
+    putU32(out, tidalStrength_);
+    putU32(out, windMin_);
+    putU32(out, windMax_);
+    putU32(out, gravity_);
+    putU32(out, hasMetalSpots_ ? 1 : 0);
+    putU32(out, metalSpots_.size());
+    for (auto const & spot : metalSpots_)
+    {
+        putF32(out, spot.x_);
+        putF32(out, spot.y_);
+        putF32(out, spot.metal_);
+        putU32(out, spot.pixels_);
+    }
+}
+
+void MapInfo::unserialize(char const * data, std::size_t size)
+{
+    using namespace BinaryIO;
+
+    Reader reader(data, size, "MapInfo");
+
+    uint32_t const version = reader.u32();
+    if (version != binaryVersion_ && version != 2)
+    {
+        throw std::runtime_error("incompatible binary version: " + std::to_string(version));
+    }
+
+    name_ = reader.string();
+    fileName_ = reader.string();
+    description_ = reader.string();
+    author_ = reader.string();
+    checksum_ = reader.u32();
+    width_ = reader.u32();
+    height_ = reader.u32();
+    tidalStrength_ = reader.u32();
+    windMin_ = reader.u32();
+    windMax_ = reader.u32();
+    gravity_ = reader.u32();
+
+    hasMetalSpots_ = false;
+    metalSpots_.clear();
+    if (version >= 3)
+    {
+        hasMetalSpots_ = reader.u32() != 0;
+        std::size_t const count = reader.u32();
+        for (std::size_t i=0; i<count; ++i)
+        {
+            MetalSpots::Spot spot;
+            spot.x_ = reader.f32();
+            spot.y_ = reader.f32();
+            spot.metal_ = reader.f32();
+            spot.pixels_ = reader.u32();
+            metalSpots_.push_back(spot);
+        }
+    }
+}
+
 bool MapInfo::operator==(MapInfo const & mi) const
 {
     if (name_ != mi.name_) return false;
@@ -108,6 +180,14 @@ bool MapInfo::operator==(MapInfo const & mi) const
     if (windMin_ != mi.windMin_) return false;
     if (windMax_ != mi.windMax_) return false;
     if (gravity_ != mi.gravity_) return false;
+    if (hasMetalSpots_ != mi.hasMetalSpots_) return false;
+    if (metalSpots_.size() != mi.metalSpots_.size()) return false;
+    for (std::size_t i=0; i<metalSpots_.size(); ++i)
+    {
+        MetalSpots::Spot const & a = metalSpots_[i];
+        MetalSpots::Spot const & b = mi.metalSpots_[i];
+        if (a.x_ != b.x_ || a.y_ != b.y_ || a.metal_ != b.metal_ || a.pixels_ != b.pixels_) return false;
+    }
 
     return true;
 }
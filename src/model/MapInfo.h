@@ -2,9 +2,13 @@
 
 #pragma once
 
+#include "image/MetalSpots.h"
+
 #include <vector>
 #include <string>
 #include <iosfwd>
+#include <cstddef>
+#include <cstdint>
 
 class UnitSync;
 
@@ -18,7 +22,8 @@ public:
         tidalStrength_(0),
         windMin_(0),
         windMax_(0),
-        gravity_(0)
+        gravity_(0),
+        hasMetalSpots_(false)
     {};
 
     std::string name_;
@@ -33,9 +38,17 @@ public:
     int windMax_;
     int gravity_;
 
+    // extracted from the metal map by Cache, not part of the text format
+    bool hasMetalSpots_;
+    std::vector<MetalSpots::Spot> metalSpots_;
+
     void serialize(std::ostream & os) const;
     void unserialize(std::istream & is); // throws on error
 
+    // compact binary format used for the map info database
+    void serialize(std::string & out) const; // appends to out
+    void unserialize(char const * data, std::size_t size); // throws on error
+
     bool operator==(MapInfo const & mi) const;
 
 private:
@@ -43,6 +56,7 @@ private:
     friend class Model;
 
     static std::string const version_; // used for compatibility check in unserialize
+    static uint32_t const binaryVersion_;
     static char const * nullToEmpty(const char * s);
 
 };
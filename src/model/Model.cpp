@@ -16,6 +16,7 @@
 #include "md5/base64.h"
 
 #include "log/Log.h"
+#include "image/PixelKernels.h"
 #include "FlobbyDirs.h"
 #include "FlobbyConfig.h"
 
@@ -23,11 +24,16 @@
 #include <json/json.h>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
 #include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <stdexcept>
 #include <sstream>
 #include <cassert>
+#include <algorithm> // set_symmetric_difference
+#include <iterator>
+
+std::size_t const Model::maxUnitSyncPoolSize_;
 
 #define ADD_MSG_HANDLER(MSG) \
     messageHandlers_[#MSG] = std::bind(&Model::handle_##MSG, this, std::placeholders::_1);
@@ -50,6 +56,9 @@ Model::Model(IController & controller, bool zerok):
     springId_(0),
     prDownloaderId_(0),
     curlId_(0),
+    unitSyncPoolSize_(0),
+    contentGeneration_(0),
+    unitSyncGeneration_(0),
     flobbyDemo_("flobby_demo"),
     requestedConnectSpring_(false)
 {
@@ -148,15 +157,128 @@ Model::~Model()
 
 void Model::setUnitSyncPath(std::string const & path)
 {
-    unitSyncPath_ = path;
-    unitSync_.reset( new UnitSync(unitSyncPath_) );
+    auto pooled = std::find_if(unitSyncPool_.begin(), unitSyncPool_.end(),
+                               [&path](PooledUnitSync const & p) { return p.path_ == path; });
 
-    refresh();
+    std::unique_ptr<UnitSync> unitSync;
+    if (pooled == unitSyncPool_.end())
+    {
+        unitSync.reset( new UnitSync(path) ); // throws on failure, current unitsync is kept then
+    }
 
-    writeableDataDir_ = unitSync_->GetWritableDataDirectory();
-    assert(!writeableDataDir_.empty());
+    std::map<std::string, int> const oldMapIndex = mapIndex_;
+    std::set<std::string> const oldGameArchives = gameArchives_;
 
+    // keep current instance loaded, reloading the same path replaces it
+    if (unitSync_ && unitSyncPoolSize_ > 0 && unitSyncPath_ != path)
+    {
+        PooledUnitSync current;
+        current.path_ = unitSyncPath_;
+        current.unitSync_ = std::move(unitSync_);
+        current.mapIndex_ = std::move(mapIndex_);
+        current.gameArchives_ = std::move(gameArchives_);
+        current.contentIndex_ = std::move(contentIndex_);
+        current.writeableDataDir_ = writeableDataDir_;
+        current.dataDirs_ = std::move(dataDirs_);
+        current.contentGeneration_ = unitSyncGeneration_;
+        unitSyncPool_.push_front(std::move(current));
+    }
+
+    unitSyncPath_ = path;
+    if (pooled != unitSyncPool_.end())
+    {
+        unitSync_ = std::move(pooled->unitSync_);
+        mapIndex_ = std::move(pooled->mapIndex_);
+        gameArchives_ = std::move(pooled->gameArchives_);
+        contentIndex_ = std::move(pooled->contentIndex_);
+        writeableDataDir_ = pooled->writeableDataDir_;
+        dataDirs_ = std::move(pooled->dataDirs_);
+        unitSyncGeneration_ = pooled->contentGeneration_;
+        unitSyncPool_.erase(pooled);
+        bool const current = contentWatcher_.fd() >= 0 && !dataDirsChanged(dataDirs_, unitSyncGeneration_);
+
+        if (current)
+        {
+            // no archives changed since it was used, no rescan needed
+            LOG(INFO) << "reusing loaded unitsync " << path;
+            updateSync();
+            emitContentChanged(oldMapIndex, oldGameArchives);
+        }
+        else
+        {
+            // refresh diffs against the indexes of the previous unitsync
+            mapIndex_ = oldMapIndex;
+            gameArchives_ = oldGameArchives;
+            refresh();
+        }
+    }
+    else
+    {
+        unitSync_ = std::move(unitSync);
+        mapIndex_ = oldMapIndex;
+        gameArchives_ = oldGameArchives;
+        refresh();
+        writeableDataDir_ = unitSync_->GetWritableDataDirectory();
+    }
+    assert(!writeableDataDir_.empty());
     LOG(DEBUG) << "writeableDataDir_:" << writeableDataDir_;
+
+    dataDirs_ = getDataDirectories();
+    unitSyncPoolSize(unitSyncPoolSize_); // trims pool and watches data dirs
+}
+
+void Model::unitSyncPoolSize(std::size_t size)
+{
+    unitSyncPoolSize_ = std::min(size, maxUnitSyncPoolSize_);
+    while (unitSyncPool_.size() > unitSyncPoolSize_)
+    {
+        LOG(DEBUG) << "unloading unitsync " << unitSyncPool_.back().path_;
+        unitSyncPool_.pop_back();
+    }
+    watchDataDirs();
+}
+
+void Model::watchDataDirs()
+{
+    std::set<std::string> dirs(dataDirs_.begin(), dataDirs_.end());
+    for (auto const & pooled : unitSyncPool_)
+    {
+        dirs.insert(pooled.dataDirs_.begin(), pooled.dataDirs_.end());
+    }
+
+    bool same = dirs.size() == dirGenerations_.size();
+    for (auto it = dirGenerations_.begin(); same && it != dirGenerations_.end(); ++it)
+    {
+        same = dirs.count(it->first) > 0;
+    }
+    if (same)
+    {
+        return;
+    }
+
+    // a dir not watched before is only used by the current instance, which has just scanned it,
+    // changes in dirs not watched anymore are not needed, no instance uses them
+    std::map<std::string, unsigned int> generations;
+    for (auto const & dir : dirs)
+    {
+        auto const it = dirGenerations_.find(dir);
+        generations[dir] = (it != dirGenerations_.end()) ? it->second : contentGeneration_;
+    }
+    dirGenerations_.swap(generations);
+    contentWatcher_.watch(std::vector<std::string>(dirs.begin(), dirs.end()));
+}
+
+bool Model::dataDirsChanged(std::vector<std::string> const & dataDirs, unsigned int generation) const
+{
+    for (auto const & dir : dataDirs)
+    {
+        auto const it = dirGenerations_.find(dir);
+        if (it == dirGenerations_.end() || it->second > generation)
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 void Model::useExternalPrDownloader(bool useExternal)
@@ -210,6 +332,7 @@ void Model::connected(bool connected)
         me_ = 0;
         battles_.clear();
         users_.clear();
+        userChannels_.clear();
         bots_.clear();
 
         if (loginInProgress_)
@@ -823,24 +946,24 @@ std::unique_ptr<uint8_t[]>  Model::getMapImage(std::string const & mapName, int
     {
         int const size = (1024 >> mipLevel)*(1024 >> mipLevel);
         res.reset(new uint8_t[size*3]);
-        uint8_t * p = res.get();
-        for (int i=0; i<size; ++i)
-        {
-            unsigned char r5 = (*rgb565 & 0xf800) >> 11;
-            unsigned char g6 = (*rgb565 & 0x07e0) >> 5;
-            unsigned char b5 = *rgb565 & 0x001f;
+        PixelKernels::rgb565ToRgb(rgb565, res.get(), size);
+    }
 
-            unsigned char r8 = (r5 << 3) | (r5 >> 2);
-            unsigned char g8 = (g6 << 2) | (g6 >> 4);
-            unsigned char b8 = (b5 << 3) | (b5 >> 2);
+    return res;
+}
 
-            p[0] = r8;
-            p[1] = g8;
-            p[2] = b8;
+std::unique_ptr<uint8_t[]>  Model::getMapImage(std::string const & mapName, int mipLevel, int w, int h)
+{
+    assert(mipLevel >=0 && mipLevel <= 8);
+    assert(w > 0 && h > 0);
 
-            rgb565 += 1;
-            p += 3;
-        }
+    std::unique_ptr<uint8_t[]> res;
+    unsigned short* rgb565 = unitSync_->GetMinimap(mapName.c_str(), mipLevel);
+    if (rgb565 != 0)
+    {
+        int const size = 1024 >> mipLevel;
+        res.reset(new uint8_t[w*h*3]);
+        PixelKernels::rgb565ToRgbResampled(rgb565, size, size, res.get(), w, h);
     }
 
     return res;
@@ -891,11 +1014,82 @@ void Model::refresh()
 {
     if (!unitSync_) return;
 
+    std::map<std::string, int> const oldMapIndex = std::move(mapIndex_);
+    std::set<std::string> const oldGameArchives = std::move(gameArchives_);
+
+    // unitsync can only rescan all archives, archives not changed are not hashed again
+    unitSyncGeneration_ = contentGeneration_;
     unitSync_->Init(true, 1);
-    unitSync_->GetPrimaryModCount();
     initMapIndex();
+    initGameArchives();
 
     updateSync();
+
+    emitContentChanged(oldMapIndex, oldGameArchives);
+}
+
+void Model::emitContentChanged(std::map<std::string, int> const & oldMapIndex, std::set<std::string> const & oldGameArchives)
+{
+    std::vector<std::string> maps;
+    for (auto const & pair : mapIndex_)
+    {
+        if (oldMapIndex.count(pair.first) == 0) maps.push_back(pair.first);
+    }
+    for (auto const & pair : oldMapIndex)
+    {
+        if (mapIndex_.count(pair.first) == 0) maps.push_back(pair.first);
+    }
+
+    std::vector<std::string> games;
+    std::set_symmetric_difference(oldGameArchives.begin(), oldGameArchives.end(),
+                                  gameArchives_.begin(), gameArchives_.end(),
+                                  std::back_inserter(games));
+
+    if (!maps.empty() || !games.empty())
+    {
+        LOG(INFO) << "content changed, maps: " << maps.size() << ", games: " << games.size();
+        contentChangedSignal_(maps, games);
+    }
+}
+
+bool Model::readContentChanges()
+{
+    std::vector<std::string> const changes = contentWatcher_.readChanges();
+    if (changes.empty())
+    {
+        return false;
+    }
+
+    // only the instances using the changed dirs need a rescan
+    ++contentGeneration_;
+    for (auto const & path : changes)
+    {
+        LOG(DEBUG) << "content changed: " << path;
+        bool const lost = path.empty(); // events lost
+        for (auto & pair : dirGenerations_)
+        {
+            std::string const & dir = pair.first;
+            if (lost || boost::algorithm::starts_with(path, (!dir.empty() && dir.back() == '/') ? dir : dir + "/"))
+            {
+                pair.second = contentGeneration_;
+            }
+        }
+    }
+    return dataDirsChanged(dataDirs_, unitSyncGeneration_);
+}
+
+std::vector<std::string> Model::getDataDirectories()
+{
+    std::vector<std::string> dirs;
+    if (!unitSync_) return dirs;
+
+    int const count = unitSync_->GetDataDirectoryCount();
+    for (int i=0; i<count; ++i)
+    {
+        char const * dir = unitSync_->GetDataDirectory(i);
+        if (dir) dirs.push_back(dir);
+    }
+    return dirs;
 }
 
 void Model::updateSync()
@@ -1006,17 +1200,15 @@ void Model::sendMyInitialBattleStatus(Battle const & battle)
 
 bool Model::gameExist(std::string const & gameName)
 {
-    if (!unitSync_) return false;
-
-    return (unitSync_->GetPrimaryModChecksumFromName( gameName.c_str()) != 0 );
+    return hasGame(gameName);
 }
 
 int Model::calcSync(Battle const & battle)
 {
     if (!unitSync_) return 2;
 
-    unsigned int const modChecksum = unitSync_->GetPrimaryModChecksumFromName( battle.modName().c_str() );
-    unsigned int const mapChecksum = unitSync_->GetMapChecksumFromName( battle.mapName().c_str() );
+    unsigned int const modChecksum = getGameChecksum(battle.modName());
+    unsigned int const mapChecksum = getMapChecksum(battle.mapName());
 
     if (modChecksum == 0 || mapChecksum == 0)
     {
@@ -1175,7 +1367,7 @@ void Model::handle_User(std::istream & is) // User content
                     }
                 }
             }
-            userChangedSignal_(user);
+            emitUserChanged(user);
         }
     }
     else
@@ -1216,6 +1408,7 @@ void Model::handle_UserDisconnected(std::istream & is) // Name Reason
     User const & user = getUser(name);
     userLeftSignal_(user);
     users_.erase(name);
+    userChannels_.erase(name);
 }
 
 void Model::handle_BattleAdded(std::istream & is) // BattleAdded content
@@ -1275,6 +1468,7 @@ void Model::handle_REMOVEUSER(std::istream & is) // userName
     User const & user = getUser(userName);
     userLeftSignal_(user);
     users_.erase(userName);
+    userChannels_.erase(userName);
 
 }
 
@@ -1295,7 +1489,7 @@ void Model::handle_BATTLEOPENED(std::istream & is)
     {
         battleOpenedSignal_(*b);
         userJoinedBattleSignal_(founder, *b);
-        userChangedSignal_(founder);
+        emitUserChanged(founder);
     }
 }
 
@@ -1388,7 +1582,7 @@ void Model::handle_JOINEDBATTLE(std::istream & is) // battleId username [scriptP
     if (loggedIn_)
     {
         userJoinedBattleSignal_(u, b);
-        userChangedSignal_(u);
+        emitUserChanged(u);
     }
     if (u == me())
     {
@@ -1417,7 +1611,7 @@ void Model::handle_JoinedBattle(std::istream & is)
     assert(loggedIn_);
 
     userJoinedBattleSignal_(u, b);
-    userChangedSignal_(u);
+    emitUserChanged(u);
 
     if (me() == u)
     {
@@ -1447,7 +1641,7 @@ void Model::handle_JoinBattleSuccess(std::istream & is)
         u.updateUserBattleStatus(userBattleStatus);
 
         userJoinedBattleSignal_(u, b);
-        userChangedSignal_(u);
+        emitUserChanged(u);
     }
 
     // join as spectator
@@ -1477,7 +1671,7 @@ void Model::handle_LEFTBATTLE(std::istream & is) // battleId username
     if (loggedIn_)
     {
         userLeftBattleSignal_(u, b);
-        userChangedSignal_(u);
+        emitUserChanged(u);
     }
     if (u == me() && b.id () == joinedBattleId_)
     {
@@ -1499,7 +1693,7 @@ void Model::handle_LeftBattle(std::istream & is)
     if (loggedIn_)
     {
         userLeftBattleSignal_(u, b);
-        userChangedSignal_(u);
+        emitUserChanged(u);
     }
     if (u == me() && b.id () == joinedBattleId_)
     {
@@ -1519,7 +1713,7 @@ void Model::handle_CLIENTSTATUS(std::istream & is) // userName status
     updateBattleRunningStatus(u);
     if (loggedIn_)
     {
-        userChangedSignal_(u);
+        emitUserChanged(u);
     }
 }
 
@@ -1613,7 +1807,7 @@ void Model::handle_CLIENTBATTLESTATUS(std::istream & is) // userName battleStatu
     extractWord(is, ex);
     u.color(boost::lexical_cast<int>(ex));
 
-    userChangedSignal_(u);
+    emitUserChanged(u);
 }
 
 void Model::handle_UpdateUserBattleStatus(std::istream & is)
@@ -1623,7 +1817,7 @@ void Model::handle_UpdateUserBattleStatus(std::istream & is)
 
     User& u = user(jv["Name"].asString());
     u.updateUserBattleStatus(jv);
-    userChangedSignal_(u);
+    emitUserChanged(u);
 }
 
 void Model::handle_REQUESTBATTLESTATUS(std::istream & is)
@@ -1828,6 +2022,7 @@ void Model::handle_JoinChannelResponse(std::istream & is)
         Json::Value const& jvUsers = jv["Channel"]["Users"];
         for (Json::ValueConstIterator it = jvUsers.begin(); it != jvUsers.end(); ++it)
         {
+            channelUserAdded(channelName, (*it).asString());
             userJoinedChannelSignal_(channelName, (*it).asString());
         }
     }
@@ -1850,6 +2045,7 @@ void Model::handle_CLIENTS(std::istream & is) // channelName {clients}
     {
         extractWord(is, userName);
         clients.push_back(userName);
+        channelUserAdded(channelName, userName);
     }
     channelClientsSignal_(channelName, clients);
 }
@@ -1931,6 +2127,12 @@ void Model::leaveChannel(std::string const & channelName)
 {
     if (!channelName.empty() && connected_)
     {
+        for (auto it = userChannels_.begin(); it != userChannels_.end(); )
+        {
+            it->second.erase(channelName);
+            it = it->second.empty() ? userChannels_.erase(it) : std::next(it);
+        }
+
         std::ostringstream oss;
         if (zerok_)
         {
@@ -1948,14 +2150,29 @@ void Model::leaveChannel(std::string const & channelName)
     }
 }
 
+void Model::initGameArchives()
+{
+    gameArchives_.clear();
+    int const count = unitSync_->GetPrimaryModCount();
+
+    for (int i=0; i<count; ++i)
+    {
+        char const * archive = unitSync_->GetPrimaryModArchive(i);
+        if (archive) gameArchives_.insert(archive);
+    }
+}
+
 void Model::initMapIndex()
 {
     mapIndex_.clear();
+    contentIndex_.clear();
     int const mapCount = unitSync_->GetMapCount();
 
     for (int i=0; i<mapCount; ++i)
     {
-        mapIndex_[unitSync_->GetMapName(i)] = i;
+        std::string const name = unitSync_->GetMapName(i);
+        mapIndex_[name] = i;
+        contentIndex_.addMap(name, unitSync_->GetMapChecksum(i));
     }
 }
 
@@ -1980,6 +2197,7 @@ void Model::handle_JOINED(std::istream & is) // channelName userName
     extractWord(is, channelName);
     std::string userName;
     extractWord(is, userName);
+    channelUserAdded(channelName, userName);
     userJoinedChannelSignal_(channelName, userName);
 }
 
@@ -1987,6 +2205,7 @@ void Model::handle_ChannelUserAdded(std::istream & is)
 {
     Json::Value jv;
     is >> jv;
+    channelUserAdded(jv["ChannelName"].asString(), jv["UserName"].asString());
     userJoinedChannelSignal_(jv["ChannelName"].asString(), jv["UserName"].asString());
 }
 
@@ -2006,6 +2225,7 @@ void Model::handle_LEFT(std::istream & is) // channelName userName [{reason}]
         extractSentence(is, reason);
     }
 
+    channelUserRemoved(channelName, userName);
     userLeftChannelSignal_(channelName, userName, reason);
 }
 
@@ -2013,9 +2233,46 @@ void Model::handle_ChannelUserRemoved(std::istream & is)
 {
     Json::Value jv;
     is >> jv;
+    channelUserRemoved(jv["ChannelName"].asString(), jv["UserName"].asString());
     userLeftChannelSignal_(jv["ChannelName"].asString(), jv["UserName"].asString(), "");
 }
 
+void Model::emitUserChanged(User const & user)
+{
+    userChangedSignal_(user);
+
+    auto const it = userChannels_.find(user.name());
+    if (it != userChannels_.end())
+    {
+        for (auto const & channelName : it->second)
+        {
+            auto const sig = channelUserChangedSignals_.find(channelName);
+            if (sig != channelUserChangedSignals_.end())
+            {
+                sig->second(user);
+            }
+        }
+    }
+}
+
+void Model::channelUserAdded(std::string const & channelName, std::string const & userName)
+{
+    userChannels_[userName].insert(channelName);
+}
+
+void Model::channelUserRemoved(std::string const & channelName, std::string const & userName)
+{
+    auto const it = userChannels_.find(userName);
+    if (it != userChannels_.end())
+    {
+        it->second.erase(channelName);
+        if (it->second.empty())
+        {
+            userChannels_.erase(it);
+        }
+    }
+}
+
 void Model::handle_CHANNELTOPIC(std::istream & is) // channelName author changedTime {topic}
 {
     using namespace LobbyProtocol;
@@ -2178,9 +2435,12 @@ std::vector<std::string> Model::getMaps()
 
 unsigned int Model::getMapChecksum(std::string const & mapName)
 {
-    if (!unitSync_) return 0;
+    return contentIndex_.mapChecksum(mapName);
+}
 
-    return unitSync_->GetMapChecksumFromName(mapName.c_str());
+bool Model::hasMap(std::string const & mapName, unsigned int checksum)
+{
+    return ContentIndex::matches(getMapChecksum(mapName), checksum);
 }
 
 void Model::handle_ADDSTARTRECT(std::istream & is) // allyNo left top right bottom
@@ -2420,20 +2680,40 @@ void Model::handle_FAILED(std::istream & is) // <command> <text>
     serverMsgSignal_(msg, 1);
 }
 
-std::vector<AI> Model::getModAIs(std::string const & modName)
+unsigned int Model::getGameChecksum(std::string const & gameName)
 {
-    std::vector<AI> ais;
+    if (!unitSync_) return 0;
 
-    if (!unitSync_) return ais;
+    if (!contentIndex_.knowsGame(gameName))
+    {
+        contentIndex_.addGame(gameName, unitSync_->GetPrimaryModChecksumFromName(gameName.c_str()));
+    }
+    return contentIndex_.gameChecksum(gameName);
+}
 
-    int modIndex = unitSync_->GetPrimaryModIndex(modName.c_str());
+bool Model::hasGame(std::string const & gameName, unsigned int checksum)
+{
+    return ContentIndex::matches(getGameChecksum(gameName), checksum);
+}
+
+GameInfo Model::getGameInfo(std::string const & gameName)
+{
+    GameInfo gameInfo;
+
+    if (!unitSync_) return gameInfo;
+
+    int modIndex = unitSync_->GetPrimaryModIndex(gameName.c_str());
     LOG(DEBUG) << "modIndex " << modIndex;
 
     if (modIndex >= 0)
     {
+        gameInfo.name_ = gameName;
+        gameInfo.checksum_ = unitSync_->GetPrimaryModChecksum(modIndex);
+
         const char* archiveName = unitSync_->GetPrimaryModArchive(modIndex);
         LOG(DEBUG) << "archiveName " << archiveName;
         unitSync_->AddAllArchives(archiveName);
+
         int aiCount = unitSync_->GetSkirmishAICount();
         LOG(DEBUG) << "aiCount " << aiCount;
 
@@ -2461,40 +2741,67 @@ std::vector<AI> Model::getModAIs(std::string const & modName)
             else
             {
                 ai.name_ = ai.info_["shortName"];
-                ais.push_back(ai);
+                gameInfo.ais_.push_back(ai);
             }
         }
-        unitSync_->RemoveAllArchives();
-    }
-
-    return ais;
-}
 
-std::vector<std::string> Model::getModSideNames(std::string const & modName)
-{
-    std::vector<std::string> sideNames;
-
-    int modIndex = unitSync_->GetPrimaryModIndex(modName.c_str());
-    LOG(DEBUG) << "modIndex " << modIndex;
-
-    if (modIndex >= 0)
-    {
-        const char* archiveName = unitSync_->GetPrimaryModArchive(modIndex);
-        LOG(DEBUG) << "archiveName " << archiveName;
-        unitSync_->AddAllArchives(archiveName);
         int sideCount = unitSync_->GetSideCount();
         LOG(DEBUG) << "sideCount " << sideCount;
 
         for (int i=0; i<sideCount; ++i)
         {
             char const* s = unitSync_->GetSideName(i);
-            LOG_IF(FATAL, s == 0)<< "side name null, " << modName << ", " << i;
-            sideNames.push_back(s);
+            LOG_IF(FATAL, s == 0)<< "side name null, " << gameName << ", " << i;
+            gameInfo.sideNames_.push_back(s);
+        }
+
+        auto const str = [](char const * s) { return std::string(s ? s : ""); };
+        int optionCount = unitSync_->GetModOptionCount();
+        LOG(DEBUG) << "optionCount " << optionCount;
+
+        for (int i=0; i<optionCount; ++i)
+        {
+            GameInfo::Option option;
+            option.key_ = boost::algorithm::to_lower_copy(str(unitSync_->GetOptionKey(i)));
+            option.name_ = str(unitSync_->GetOptionName(i));
+            option.section_ = str(unitSync_->GetOptionSection(i));
+            option.desc_ = str(unitSync_->GetOptionDesc(i));
+            option.type_ = static_cast<GameInfo::OptionType>(unitSync_->GetOptionType(i));
+
+            switch (option.type_)
+            {
+            case GameInfo::OT_BOOL:
+                option.default_ = unitSync_->GetOptionBoolDef(i) ? "1" : "0";
+                break;
+            case GameInfo::OT_NUMBER:
+            {
+                std::ostringstream oss; // default precision, lexical_cast gives 0.100000001
+                oss << unitSync_->GetOptionNumberDef(i);
+                option.default_ = oss.str();
+                break;
+            }
+            case GameInfo::OT_STRING:
+                option.default_ = str(unitSync_->GetOptionStringDef(i));
+                break;
+            case GameInfo::OT_LIST:
+                option.default_ = str(unitSync_->GetOptionListDef(i));
+                for (int item=0; item<unitSync_->GetOptionListCount(i); ++item)
+                {
+                    option.listItems_.push_back(std::make_pair(str(unitSync_->GetOptionListItemKey(i, item)),
+                                                               str(unitSync_->GetOptionListItemName(i, item))));
+                }
+                break;
+            default:
+                break;
+            }
+            gameInfo.options_.push_back(option);
         }
+        gameInfo.hasOptions_ = true;
+
         unitSync_->RemoveAllArchives();
     }
 
-    return sideNames;
+    return gameInfo;
 }
 
 void Model::addBot(Bot const & bot)
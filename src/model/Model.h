@@ -13,11 +13,15 @@
 #include "StartRect.h"
 #include "ServerInfo.h"
 #include "AI.h"
+#include "GameInfo.h"
+#include "ContentWatcher.h"
+#include "ContentIndex.h"
 
 #include <boost/signals2/signal.hpp>
 #include <sstream>
 #include <unordered_map>
 #include <functional>
+#include <list>
 #include <map>
 #include <set>
 #include <string>
@@ -40,6 +44,8 @@ public:
     void setSpringPath(std::string const & path) { springPath_ = path; }
     void setSpringOptions(std::string const & options) { springOptions_ = options; }
     void setUnitSyncPath(std::string const & path);
+    // number of previously used unitsync libraries kept loaded so switching back to them is quick, 0 disables
+    void unitSyncPoolSize(std::size_t size);
     void useExternalPrDownloader(bool useExternal);
     void setPrDownloaderCmd(std::string const & cmd);
     std::string const & getSpringPath() const { return springPath_; }
@@ -100,11 +106,12 @@ public:
     void checkPing(); // call regularly to make sure we send a PING at least every 30s, it will also check if we got the PONG back
 
     // map
-    unsigned int getMapChecksum(std::string const & mapName); // returns 0 if map not found
+    unsigned int getMapChecksum(std::string const & mapName); // returns 0 if map not found, uses content index
     std::vector<std::string> getMaps();
     MapInfo getMapInfo(std::string const & mapName);
     void getMapSize(std::string const & mapName, int & w, int & h); // TODO remove
     std::unique_ptr<uint8_t[]> getMapImage(std::string const & mapName, int mipLevel); // returns RGB data, mipLevel: 0->1024x1024, 1->512x512 ...
+    std::unique_ptr<uint8_t[]> getMapImage(std::string const & mapName, int mipLevel, int w, int h); // returns RGB data scaled to w x h
     std::unique_ptr<uint8_t[]> getMetalMap(std::string const & mapName, int & w, int & h); // returns single component data
     std::unique_ptr<uint8_t[]> getHeightMap(std::string const & mapName, int & w, int & h); // returns single component data
 
@@ -117,10 +124,19 @@ public:
     // mod
     bool gameExist(std::string const & gameName);
 
-    void refresh(); // to find new mods and maps
+    void refresh(); // to find new mods and maps, emits content changed signal if maps or games were added or removed
 
-    std::vector<AI> getModAIs(std::string const & modName);
-    std::vector<std::string> getModSideNames(std::string const & modName);
+    // content watcher, fd is -1 if not available
+    int contentWatcherFd() const { return contentWatcher_.fd(); }
+    bool readContentChanges(); // returns true if archives of the current engine were added or removed, call refresh to pick them up
+    std::vector<std::string> getDataDirectories();
+
+    unsigned int getGameChecksum(std::string const & gameName); // returns 0 if game not found, uses content index
+    ContentIndex const & contentIndex() const { return contentIndex_; } // copied for use in other threads
+    // true if map/game is installed and checksum matches (0 matches any), cheap enough to call for every battle
+    bool hasMap(std::string const & mapName, unsigned int checksum = 0);
+    bool hasGame(std::string const & gameName, unsigned int checksum = 0);
+    GameInfo getGameInfo(std::string const & gameName); // mounts the game archives, use Cache::getGameInfo
 
     // ServerCommands specific methods
     void subscribeChannel(std::string const & channelName);
@@ -157,6 +173,10 @@ public:
     boost::signals2::connection connectUserChanged(UserChangedSignal::slot_type subscriber)
     { return userChangedSignal_.connect(subscriber); }
 
+    // only called for users in channelName, i.e. a channel we joined
+    boost::signals2::connection connectChannelUserChanged(std::string const & channelName, UserChangedSignal::slot_type subscriber)
+    { return channelUserChangedSignals_[channelName].connect(subscriber); }
+
     typedef boost::signals2::signal<void (User const & user)> UserLeftSignal;
     boost::signals2::connection connectUserLeft(UserLeftSignal::slot_type subscriber)
     { return userLeftSignal_.connect(subscriber); }
@@ -213,6 +233,11 @@ public:
     boost::signals2::connection connectDownloadDone(DownloadDoneSignal::slot_type subscriber)
     { return downloadDoneSignal_.connect(subscriber); }
 
+    // names of maps and game archives added or removed by refresh
+    typedef boost::signals2::signal<void (std::vector<std::string> const & maps, std::vector<std::string> const & gameArchives)> ContentChangedSignal;
+    boost::signals2::connection connectContentChanged(ContentChangedSignal::slot_type subscriber)
+    { return contentChangedSignal_.connect(subscriber); }
+
     typedef boost::signals2::signal<void (std::string const & msg, int interest)> ServerMsgSignal;
     boost::signals2::connection connectServerMsg(ServerMsgSignal::slot_type subscriber)
     { return serverMsgSignal_.connect(subscriber); }
@@ -337,6 +362,7 @@ private:
     AgreementSignal agreementSignal_;
     UserJoinedSignal userJoinedSignal_;
     UserChangedSignal userChangedSignal_;
+    std::map<std::string, UserChangedSignal> channelUserChangedSignals_; // channel name -> signal
     UserLeftSignal userLeftSignal_;
     BattleOpenedSignal battleOpenedSignal_;
     BattleClosedSignal battleClosedSignal_;
@@ -351,6 +377,7 @@ private:
     BattleChatMsgSignal battleChatMsgSignal_;
     SpringExitSignal springExitSignal_;
     DownloadDoneSignal downloadDoneSignal_;
+    ContentChangedSignal contentChangedSignal_;
     ServerMsgSignal serverMsgSignal_;
     SayPrivateSignal sayPrivateSignal_;
     SaidPrivateSignal saidPrivateSignal_;
@@ -381,9 +408,42 @@ private:
 
     Bots bots_;
     Channels channels_; // last retrieved channel list
+    std::map<std::string, std::set<std::string>> userChannels_; // user name -> joined channels the user is in
+    void emitUserChanged(User const & user); // to all and to channels of user
+    void channelUserAdded(std::string const & channelName, std::string const & userName);
+    void channelUserRemoved(std::string const & channelName, std::string const & userName);
 
     std::map<std::string, int> mapIndex_;
-    void initMapIndex();
+    ContentIndex contentIndex_;
+    void initMapIndex(); // also content index
+    std::set<std::string> gameArchives_;
+    void initGameArchives();
+    ContentWatcher contentWatcher_;
+    void emitContentChanged(std::map<std::string, int> const & oldMapIndex, std::set<std::string> const & oldGameArchives);
+
+    // unitsync instances not in use, the data dirs of all instances stay watched and each dir remembers
+    // the content generation of its last change, a pooled instance whose dirs did not change since its
+    // last scan does not need a rescan
+    struct PooledUnitSync
+    {
+        std::string path_;
+        std::unique_ptr<UnitSync> unitSync_;
+        std::map<std::string, int> mapIndex_;
+        std::set<std::string> gameArchives_;
+        ContentIndex contentIndex_;
+        std::string writeableDataDir_;
+        std::vector<std::string> dataDirs_;
+        unsigned int contentGeneration_; // of last scan
+    };
+    std::list<PooledUnitSync> unitSyncPool_; // most recently used first
+    std::size_t unitSyncPoolSize_;
+    unsigned int contentGeneration_; // bumped on every change
+    unsigned int unitSyncGeneration_; // of last scan of current instance
+    std::vector<std::string> dataDirs_; // of current instance
+    std::map<std::string, unsigned int> dirGenerations_; // watched by contentWatcher_ -> generation of last change
+    void watchDataDirs(); // union of current and pooled data dirs
+    bool dataDirsChanged(std::vector<std::string> const & dataDirs, unsigned int generation) const;
+    static std::size_t const maxUnitSyncPoolSize_ = 8; // each library path uses one of the 16 dlmopen namespaces
     std::unique_ptr<uint8_t[]> getInfoMap(std::string const & mapName, std::string const & type, int & w, int & h);
 
     User & user(std::string const & str);
@@ -0,0 +1,447 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#include "PackFile.h"
+
+#include "log/Log.h"
+
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio> // rename
+#include <cstring>
+#include <stdexcept>
+
+// file layout:
+// file header: "FLOBBYPK" <uint32 version> <uint32 0>
+// records: <uint32 type> <uint32 key size> <uint64 data size> <key> <pad to 8> <data> <pad to 8>
+
+namespace
+{
+
+char const fileMagic[8] = { 'F','L','O','B','B','Y','P','K' };
+uint32_t const fileVersion = 1;
+std::size_t const fileHeaderSize = 16;
+
+uint32_t const typePut = 0x52504b46; // "FKPR"
+uint32_t const typeRemove = 0x44504b46; // "FKPD"
+
+struct RecordHeader
+{
+    uint32_t type_;
+    uint32_t keySize_;
+    uint64_t dataSize_;
+};
+
+std::size_t const minMapSize = 4*1024*1024;
+
+inline std::size_t pad8(std::size_t size)
+{
+    return (size + 7) & ~static_cast<std::size_t>(7);
+}
+
+void writeAll(int fd, void const * data, std::size_t size, off_t offset)
+{
+    char const * p = static_cast<char const *>(data);
+    while (size > 0)
+    {
+        ssize_t const res = ::pwrite(fd, p, size, offset);
+        if (res < 0)
+        {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("pack file write failed: ") + std::strerror(errno));
+        }
+        p += res;
+        size -= res;
+        offset += res;
+    }
+}
+
+std::vector<uint8_t> fileHeader()
+{
+    std::vector<uint8_t> header(fileHeaderSize, 0);
+    std::memcpy(&header[0], fileMagic, sizeof(fileMagic));
+    std::memcpy(&header[8], &fileVersion, sizeof(fileVersion));
+    return header;
+}
+
+std::vector<uint8_t> record(std::string const & key, void const * data, std::size_t size, uint32_t type)
+{
+    RecordHeader const header = { type, static_cast<uint32_t>(key.size()), size };
+
+    std::size_t const dataOffset = sizeof(header) + pad8(key.size());
+    std::vector<uint8_t> rec(dataOffset + pad8(size), 0);
+    std::memcpy(&rec[0], &header, sizeof(header));
+    std::memcpy(&rec[sizeof(header)], key.data(), key.size());
+    if (size > 0)
+    {
+        std::memcpy(&rec[dataOffset], data, size);
+    }
+    return rec;
+}
+
+} // namespace
+
+PackFile::PackFile(std::string const & path):
+    path_(path),
+    fd_(-1),
+    base_(0),
+    capacity_(0),
+    end_(0),
+    garbage_(0)
+{
+    open();
+}
+
+PackFile::~PackFile()
+{
+    close();
+    for (auto const & m: mappings_)
+    {
+        ::munmap(m.first, m.second);
+    }
+}
+
+void PackFile::open()
+{
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+    {
+        LOG(WARNING) << "failed to open " << path_ << ": " << std::strerror(errno);
+        throw std::runtime_error("failed to open pack file: " + path_);
+    }
+
+    base_ = 0;
+    capacity_ = 0;
+    end_ = 0;
+    garbage_ = 0;
+    index_.clear();
+
+    lock();
+    try
+    {
+        sync();
+    }
+    catch (...)
+    {
+        unlock();
+        throw;
+    }
+    unlock();
+}
+
+void PackFile::close()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void PackFile::lock()
+{
+    while (::flock(fd_, LOCK_EX) != 0)
+    {
+        if (errno != EINTR)
+        {
+            throw std::runtime_error(std::string("pack file lock failed: ") + std::strerror(errno));
+        }
+    }
+}
+
+void PackFile::unlock()
+{
+    ::flock(fd_, LOCK_UN);
+}
+
+void PackFile::sync()
+{
+    // file replaced by compaction in other process
+    struct stat stPath;
+    struct stat stFd;
+    if (::fstat(fd_, &stFd) != 0)
+    {
+        throw std::runtime_error("pack file stat failed: " + path_);
+    }
+    if (::stat(path_.c_str(), &stPath) == 0 && (stPath.st_ino != stFd.st_ino || stPath.st_dev != stFd.st_dev))
+    {
+        close();
+        open(); // takes the lock of the new file and syncs it, old lock is released with the old fd
+        lock();
+        return;
+    }
+
+    std::size_t const size = stFd.st_size;
+
+    if (end_ == 0)
+    {
+        // new or reopened file
+        bool headerOk = false;
+        if (size >= fileHeaderSize)
+        {
+            map(size);
+            headerOk = std::memcmp(&fileHeader()[0], base_, fileHeaderSize) == 0;
+        }
+        if (!headerOk)
+        {
+            std::vector<uint8_t> const header = fileHeader();
+            if (size == 0)
+            {
+                writeAll(fd_, &header[0], header.size(), 0);
+                end_ = fileHeaderSize;
+                map(end_);
+                return;
+            }
+
+            // replaced like in compact, other instances may have the bad file mapped
+            LOG(WARNING) << "bad pack file header, resetting " << path_;
+            std::string const tmpPath = path_ + ".tmp";
+            int const fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                throw std::runtime_error("failed to create " + tmpPath);
+            }
+            try
+            {
+                writeAll(fd, &header[0], header.size(), 0);
+            }
+            catch (...)
+            {
+                ::close(fd);
+                std::remove(tmpPath.c_str());
+                throw;
+            }
+            ::close(fd);
+
+            if (std::rename(tmpPath.c_str(), path_.c_str()) != 0)
+            {
+                std::remove(tmpPath.c_str());
+                throw std::runtime_error("failed to rename " + tmpPath);
+            }
+            close();
+            open(); // takes the lock of the new file and syncs it
+            lock();
+            return;
+        }
+        end_ = fileHeaderSize;
+    }
+
+    if (size > end_)
+    {
+        map(size);
+        scan(size);
+    }
+}
+
+void PackFile::map(std::size_t size)
+{
+    if (size <= capacity_)
+    {
+        return;
+    }
+
+    // map more than needed so appends rarely need a new mapping, mapping past the end of file is ok
+    std::size_t const capacity = std::max(minMapSize, 2*size);
+    void * p = ::mmap(0, capacity, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED)
+    {
+        throw std::runtime_error(std::string("pack file mmap failed: ") + std::strerror(errno));
+    }
+    mappings_.push_back(std::make_pair(p, capacity));
+    base_ = static_cast<uint8_t const *>(p);
+    capacity_ = capacity;
+}
+
+void PackFile::scan(std::size_t size)
+{
+    std::size_t pos = end_;
+    while (pos < size)
+    {
+        if (size - pos < sizeof(RecordHeader))
+        {
+            break;
+        }
+        RecordHeader header;
+        std::memcpy(&header, base_ + pos, sizeof(header));
+        if (header.type_ != typePut && header.type_ != typeRemove)
+        {
+            break;
+        }
+        std::size_t const dataOffset = pos + sizeof(header) + pad8(header.keySize_);
+        if (header.dataSize_ > size || dataOffset + pad8(header.dataSize_) > size)
+        {
+            break;
+        }
+        std::size_t const recordSize = dataOffset + pad8(header.dataSize_) - pos;
+
+        std::string const key(reinterpret_cast<char const *>(base_ + pos + sizeof(header)), header.keySize_);
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            garbage_ += it->second.recordSize_;
+            index_.erase(it);
+        }
+        if (header.type_ == typePut)
+        {
+            Entry const entry = { dataOffset, header.dataSize_, recordSize };
+            index_[key] = entry;
+        }
+        else
+        {
+            garbage_ += recordSize;
+        }
+
+        pos += recordSize;
+    }
+
+    if (pos < size)
+    {
+        // partial write from a crash, drop it
+        LOG(WARNING) << "dropping " << (size - pos) << " bad bytes at end of " << path_;
+        if (::ftruncate(fd_, pos) != 0)
+        {
+            throw std::runtime_error("pack file truncate failed: " + path_);
+        }
+    }
+    end_ = pos;
+}
+
+bool PackFile::has(std::string const & key) const
+{
+    return index_.find(key) != index_.end();
+}
+
+uint8_t const * PackFile::get(std::string const & key, std::size_t & size) const
+{
+    auto it = index_.find(key);
+    if (it == index_.end())
+    {
+        return 0;
+    }
+    size = it->second.size_;
+    return base_ + it->second.offset_;
+}
+
+std::vector<std::string> PackFile::keys() const
+{
+    std::vector<std::string> res;
+    res.reserve(index_.size());
+    for (auto const & pair: index_)
+    {
+        res.push_back(pair.first);
+    }
+    return res;
+}
+
+void PackFile::put(std::string const & key, void const * data, std::size_t size)
+{
+    append(key, data, size, typePut);
+}
+
+void PackFile::remove(std::string const & key)
+{
+    if (has(key))
+    {
+        append(key, 0, 0, typeRemove);
+    }
+}
+
+void PackFile::append(std::string const & key, void const * data, std::size_t size, uint32_t type)
+{
+    std::vector<uint8_t> const rec = record(key, data, size, type);
+
+    lock();
+    try
+    {
+        sync();
+        writeAll(fd_, &rec[0], rec.size(), end_);
+        map(end_ + rec.size());
+        scan(end_ + rec.size());
+    }
+    catch (...)
+    {
+        unlock();
+        throw;
+    }
+    unlock();
+}
+
+void PackFile::reload()
+{
+    lock();
+    try
+    {
+        sync();
+    }
+    catch (...)
+    {
+        unlock();
+        throw;
+    }
+    unlock();
+}
+
+void PackFile::compact()
+{
+    lock();
+    try
+    {
+        sync();
+
+        // keep records in file order
+        std::vector<std::pair<uint64_t, std::string const *> > live;
+        live.reserve(index_.size());
+        for (auto const & pair: index_)
+        {
+            live.push_back(std::make_pair(pair.second.offset_, &pair.first));
+        }
+        std::sort(live.begin(), live.end());
+
+        std::string const tmpPath = path_ + ".tmp";
+        int const fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            throw std::runtime_error("failed to create " + tmpPath);
+        }
+        try
+        {
+            std::vector<uint8_t> const header = fileHeader();
+            writeAll(fd, &header[0], header.size(), 0);
+            off_t offset = header.size();
+            for (auto const & l: live)
+            {
+                Entry const & entry = index_[*l.second];
+                std::vector<uint8_t> const rec = record(*l.second, base_ + entry.offset_, entry.size_, typePut);
+                writeAll(fd, &rec[0], rec.size(), offset);
+                offset += rec.size();
+            }
+        }
+        catch (...)
+        {
+            ::close(fd);
+            std::remove(tmpPath.c_str());
+            throw;
+        }
+        ::close(fd);
+
+        if (std::rename(tmpPath.c_str(), path_.c_str()) != 0)
+        {
+            std::remove(tmpPath.c_str());
+            throw std::runtime_error("failed to rename " + tmpPath);
+        }
+    }
+    catch (...)
+    {
+        unlock();
+        throw;
+    }
+
+    LOG(INFO) << "compacted " << path_ << ", removed " << garbage_ << " bytes";
+
+    // old mappings stay, pointers returned by get are still valid
+    close(); // releases lock
+    open();
+}
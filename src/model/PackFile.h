@@ -0,0 +1,63 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Single file key/value store, used for cache data that would otherwise be thousands of small files.
+// The file is an append-only log of records, the last record of a key wins. The file is memory mapped
+// and get() returns pointers into the mapping. Mappings are kept until the PackFile is destroyed so
+// returned pointers stay valid across put() and compact().
+// Appends are serialized with flock so several flobby instances can share a pack file.
+class PackFile
+{
+public:
+    PackFile(std::string const & path); // opens or creates file, throws on failure
+    virtual ~PackFile();
+
+    std::string const & path() const { return path_; }
+
+    bool has(std::string const & key) const;
+    uint8_t const * get(std::string const & key, std::size_t & size) const; // returns 0 if not found
+    std::vector<std::string> keys() const;
+    std::size_t count() const { return index_.size(); }
+
+    void put(std::string const & key, void const * data, std::size_t size); // throws on failure
+    void remove(std::string const & key);
+
+    std::size_t fileSize() const { return end_; }
+    std::size_t garbageSize() const { return garbage_; } // bytes used by replaced and removed records
+    void compact(); // rewrites the file with live records only
+    void reload(); // picks up records added, removed or compacted by other PackFile instances
+
+private:
+    struct Entry
+    {
+        uint64_t offset_; // data offset
+        uint64_t size_; // data size
+        uint64_t recordSize_;
+    };
+
+    std::string const path_;
+    int fd_;
+    std::vector<std::pair<void*, std::size_t> > mappings_; // last one is current
+    uint8_t const * base_;
+    std::size_t capacity_; // size of current mapping
+    std::size_t end_; // end of last valid record
+    std::size_t garbage_;
+    std::unordered_map<std::string, Entry> index_;
+
+    void open();
+    void close();
+    void lock();
+    void unlock();
+    void sync(); // picks up records appended (or file replaced) by other processes, must be locked
+    void map(std::size_t size);
+    void scan(std::size_t size);
+    void append(std::string const & key, void const * data, std::size_t size, uint32_t type);
+};
@@ -0,0 +1,144 @@
+// This file is part of flobby (GPL v2 or later), see the LICENSE file
+
+// benchmarks of the image kernels against the loops they replaced, run with "make runbench"
+
+#include "image/PixelKernels.h"
+#include "image/Resample.h"
+#include "image/MetalSpots.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace PixelKernels;
+
+static int const SIZE = 1024; // unitsync minimap size at mip level 0
+static int const N = SIZE*SIZE;
+static int const SCALED = 128;
+
+static
+void bench(std::string const & name, std::function<void()> f)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    f(); // warm up
+
+    int const iterations = 20;
+    auto const start = Clock::now();
+    for (int i=0; i<iterations; ++i)
+    {
+        f();
+    }
+    double const ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+    std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(3) << std::setw(10) << ms << " ms" << std::endl;
+}
+
+// old Model::getMapImage loop
+static
+void legacyRgb565(uint16_t const * rgb565, uint8_t * p, int size)
+{
+    for (int i=0; i<size; ++i)
+    {
+        unsigned char r5 = (*rgb565 & 0xf800) >> 11;
+        unsigned char g6 = (*rgb565 & 0x07e0) >> 5;
+        unsigned char b5 = *rgb565 & 0x001f;
+
+        unsigned char r8 = (r5 << 3) | (r5 >> 2);
+        unsigned char g8 = (g6 << 2) | (g6 >> 4);
+        unsigned char b8 = (b5 << 3) | (b5 >> 2);
+
+        p[0] = r8;
+        p[1] = g8;
+        p[2] = b8;
+
+        rgb565 += 1;
+        p += 3;
+    }
+}
+
+// old Cache::getMetalImage loop
+static
+void legacyMetal(uint8_t const * imageData, uint8_t * rgb, int size)
+{
+    for (int i=0; i<size; ++i)
+    {
+        rgb[i*3+0] = 0;
+        rgb[i*3+1] = imageData[i];
+        rgb[i*3+2] = 0;
+    }
+}
+
+int main()
+{
+    std::vector<uint16_t> rgb565(N);
+    std::vector<uint8_t> gray(N);
+    for (int i=0; i<N; ++i)
+    {
+        rgb565[i] = static_cast<uint16_t>(i*2654435761u >> 11);
+        gray[i] = static_cast<uint8_t>(i*40503u >> 9);
+    }
+    std::vector<uint8_t> rgb(N*3);
+    std::vector<uint8_t> scaled(SCALED*SCALED*3);
+
+    std::vector<Isa> isas;
+    for (Isa isa: { ISA_SCALAR, ISA_SSE2, ISA_AVX2 })
+    {
+        if (isaSupported(isa)) isas.push_back(isa);
+    }
+
+    std::cout << "rgb565 -> rgb888, " << SIZE << "x" << SIZE << std::endl;
+    bench("legacy loop", [&]() { legacyRgb565(rgb565.data(), rgb.data(), N); });
+    for (Isa isa: isas)
+    {
+        bench(isaName(isa), [&]() { rgb565ToRgb(rgb565.data(), rgb.data(), N, isa); });
+    }
+
+    std::cout << std::endl << "metal -> rgb888, " << SIZE << "x" << SIZE << std::endl;
+    bench("legacy loop", [&]() { legacyMetal(gray.data(), rgb.data(), N); });
+    for (Isa isa: isas)
+    {
+        bench(isaName(isa), [&]() { grayToRgb(gray.data(), rgb.data(), N, 1, isa); });
+    }
+
+    std::cout << std::endl << "rgb565 " << SIZE << "x" << SIZE << " -> rgb888 " << SCALED << "x" << SCALED << std::endl;
+    bench("legacy loop + resample", [&]()
+    {
+        std::unique_ptr<uint8_t[]> full(new uint8_t[N*3]);
+        legacyRgb565(rgb565.data(), full.get(), N);
+        Resample::area(full.get(), SIZE, SIZE, 3, scaled.data(), SCALED, SCALED);
+    });
+    for (Isa isa: isas)
+    {
+        bench(std::string(isaName(isa)) + " fused", [&]()
+        {
+            rgb565ToRgbResampled(rgb565.data(), SIZE, SIZE, scaled.data(), SCALED, SCALED, isa);
+        });
+    }
+
+    // metal map of a 32x32 map with 64 spots of 5x5 pixels
+    int const metalSize = 1024;
+    std::vector<uint8_t> metal(metalSize*metalSize, 0);
+    for (int s=0; s<64; ++s)
+    {
+        int const x0 = 64 + (s % 8)*110;
+        int const y0 = 64 + (s / 8)*110;
+        for (int y=0; y<5; ++y)
+        {
+            for (int x=0; x<5; ++x)
+            {
+                metal[(y0 + y)*metalSize + x0 + x] = 255;
+            }
+        }
+    }
+    std::cout << std::endl << "metal spots, " << metalSize << "x" << metalSize << std::endl;
+    for (Isa isa: isas)
+    {
+        bench(isaName(isa), [&]() { MetalSpots::find(metal.data(), metalSize, metalSize, 0, 2, isa); });
+    }
+
+    return 0;
+}
@@ -3,12 +3,28 @@
 #include "model/Model.h"
 #include "gui/MyImage.h"
 #include "gui/TextFunctions.h"
+#include "gui/NameIndex.h"
+#include "gui/ChatBuffer.h"
+#include "gui/LogReader.h"
+#include "gui/StringTable.h"
 #include "log/Log.h"
 #include "FlobbyDirs.h"
 #include "model/Nightwatch.h"
 #include "model/LobbyProtocol.h"
+#include "model/PackFile.h"
+#include "model/MapInfo.h"
+#include "model/GameInfo.h"
+#include "model/MapFilter.h"
+#include "model/BattleFilter.h"
+#include "model/Battle.h"
+#include "model/ContentWatcher.h"
+#include "model/ContentIndex.h"
+#include "image/PixelKernels.h"
+#include "image/Resample.h"
+#include "image/MetalSpots.h"
 
 #include <boost/lexical_cast.hpp>
+#include <boost/filesystem.hpp>
 #define BOOST_TEST_DYN_LINK // this will define BOOST_TEST_ALTERNATIVE_INIT_API in boost/test/detail/config.hpp
 #define BOOST_TEST_ALTERNATIVE_INIT_API // here for clarity
 #define BOOST_TEST_NO_MAIN
@@ -20,6 +36,10 @@
 #include <string>
 #include <memory>
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include <vector>
 
 static
 bool init_unit_test()
@@ -510,12 +530,668 @@ BOOST_AUTO_TEST_CASE(testMyImage)
         BOOST_CHECK_EQUAL(static_cast<uchar>('1'), image.array[0]);
     }
 
+    // write and read back, data containing newlines
+    {
+        std::string const fileName("MyImageTestFile");
+        uchar const data[] = { '\n', 0, 255, '\r', '\n', 7 };
+
+        MyImage::write(fileName, data, 1, 2, 3);
+        MyImage image(fileName);
+
+        BOOST_CHECK_EQUAL(1, image.w());
+        BOOST_CHECK_EQUAL(2, image.h());
+        BOOST_CHECK_EQUAL(3, image.d());
+        BOOST_CHECK(std::equal(data, data + 6, image.array));
+
+        BOOST_CHECK_THROW(MyImage::write(fileName, data, 0, 2, 3), std::runtime_error);
+    }
+
+    // in memory header
+    {
+        std::string const image = MyImage::header(2, 1, 3) + "123456";
+        uchar const * data = reinterpret_cast<uchar const *>(image.data());
+        int w, h, d;
+        BOOST_CHECK_EQUAL(image.size() - 6, MyImage::parseHeader(data, image.size(), w, h, d));
+        BOOST_CHECK_EQUAL(2, w);
+        BOOST_CHECK_EQUAL(1, h);
+        BOOST_CHECK_EQUAL(3, d);
+        BOOST_CHECK_EQUAL(0, MyImage::parseHeader(data, image.size() - 1, w, h, d)); // size mismatch
+    }
+
     // test exception is thrown if file not found
     {
         BOOST_CHECK_THROW(MyImage image("non_existing_file"), std::invalid_argument);
     }
 }
 
+BOOST_AUTO_TEST_CASE(testPixelKernels)
+{
+    using namespace PixelKernels;
+
+    // all RGB565 values with the reference conversion (the old per pixel loop in Model::getMapImage)
+    std::vector<uint16_t> rgb565(0x10000);
+    std::vector<uint8_t> expected(rgb565.size()*3);
+    for (std::size_t i=0; i<rgb565.size(); ++i)
+    {
+        rgb565[i] = static_cast<uint16_t>(i);
+        uint8_t const r5 = (i & 0xf800) >> 11;
+        uint8_t const g6 = (i & 0x07e0) >> 5;
+        uint8_t const b5 = i & 0x001f;
+        expected[i*3+0] = (r5 << 3) | (r5 >> 2);
+        expected[i*3+1] = (g6 << 2) | (g6 >> 4);
+        expected[i*3+2] = (b5 << 3) | (b5 >> 2);
+    }
+
+    std::vector<uint8_t> gray(1000);
+    for (std::size_t i=0; i<gray.size(); ++i)
+    {
+        gray[i] = static_cast<uint8_t>(i*7 + 3);
+    }
+
+    for (Isa isa: { ISA_SCALAR, ISA_SSE2, ISA_AVX2 })
+    {
+        if (!isaSupported(isa)) continue;
+        BOOST_TEST_MESSAGE(isaName(isa));
+
+        std::vector<uint8_t> rgb(rgb565.size()*3);
+        rgb565ToRgb(rgb565.data(), rgb.data(), rgb565.size(), isa);
+        BOOST_CHECK(rgb == expected);
+
+        // all lengths around the vector sizes, checks tail handling and that nothing is written past the end
+        for (std::size_t n=0; n<=70; ++n)
+        {
+            std::vector<uint8_t> out(n*3 + 16, 0xAB);
+            rgb565ToRgb(rgb565.data() + 0x1234, out.data(), n, isa);
+            BOOST_CHECK(std::equal(out.begin(), out.begin() + n*3, expected.begin() + 0x1234*3));
+            BOOST_CHECK(std::count(out.begin() + n*3, out.end(), 0xAB) == 16);
+
+            for (int channel=0; channel<3; ++channel)
+            {
+                std::vector<uint8_t> out(n*3 + 16, 0xAB);
+                grayToRgb(gray.data(), out.data(), n, channel, isa);
+                for (std::size_t i=0; i<n; ++i)
+                {
+                    for (int c=0; c<3; ++c)
+                    {
+                        BOOST_CHECK_EQUAL(out[i*3+c], c == channel ? gray[i] : 0);
+                    }
+                }
+                BOOST_CHECK(std::count(out.begin() + n*3, out.end(), 0xAB) == 16);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testMetalSpots)
+{
+    using namespace PixelKernels;
+
+    // find kernels, all isas and all positions of the first match
+    for (Isa isa: { ISA_SCALAR, ISA_SSE2, ISA_AVX2 })
+    {
+        if (!isaSupported(isa)) continue;
+
+        std::vector<uint8_t> data(100, 0);
+        BOOST_CHECK_EQUAL(100, findAbove(data.data(), data.size(), 0, isa));
+        BOOST_CHECK_EQUAL(0, findNotAbove(data.data(), data.size(), 0, isa));
+        for (std::size_t pos=0; pos<data.size(); ++pos)
+        {
+            std::vector<uint8_t> above(100, 10);
+            above[pos] = 11;
+            BOOST_CHECK_EQUAL(pos, findAbove(above.data(), above.size(), 10, isa));
+
+            std::vector<uint8_t> notAbove(100, 200);
+            notAbove[pos] = 10;
+            BOOST_CHECK_EQUAL(pos, findNotAbove(notAbove.data(), notAbove.size(), 10, isa));
+        }
+    }
+
+    // two spots, one of them diagonal, one single pixel ignored
+    int const w = 40;
+    int const h = 20;
+    std::vector<uint8_t> metal(w*h, 0);
+    auto set = [&metal](int x, int y, uint8_t v) { metal[y*w + x] = v; };
+    for (int y=2; y<4; ++y)
+    {
+        for (int x=2; x<4; ++x)
+        {
+            set(x, y, 255);
+        }
+    }
+    set(30, 10, 100);
+    set(31, 11, 100);
+    set(32, 12, 100);
+    set(20, 18, 255);
+
+    for (Isa isa: { ISA_SCALAR, ISA_SSE2, ISA_AVX2 })
+    {
+        if (!isaSupported(isa)) continue;
+
+        std::vector<MetalSpots::Spot> const spots = MetalSpots::find(metal.data(), w, h, 0, 2, isa);
+        BOOST_REQUIRE_EQUAL(2, spots.size());
+
+        BOOST_CHECK_CLOSE(3.0f/w, spots[0].x_, 0.01);
+        BOOST_CHECK_CLOSE(3.0f/h, spots[0].y_, 0.01);
+        BOOST_CHECK_CLOSE(4.0f, spots[0].metal_, 0.01);
+        BOOST_CHECK_EQUAL(4, spots[0].pixels_);
+
+        BOOST_CHECK_CLOSE(31.5f/w, spots[1].x_, 0.01);
+        BOOST_CHECK_CLOSE(11.5f/h, spots[1].y_, 0.01);
+        BOOST_CHECK_EQUAL(3, spots[1].pixels_);
+
+        BOOST_CHECK_CLOSE(4.0f + 300.0f/255, MetalSpots::totalMetal(spots), 0.01);
+    }
+
+    // u shape joined on last row
+    {
+        std::vector<uint8_t> u = {
+            1, 0, 0, 1,
+            1, 0, 0, 1,
+            1, 1, 1, 1 };
+        BOOST_CHECK_EQUAL(1, MetalSpots::find(u.data(), 4, 3).size());
+    }
+
+    BOOST_CHECK_THROW(MetalSpots::find(metal.data(), 0, h), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testResample)
+{
+    // same size is a copy
+    {
+        uint8_t const src[] = { 1, 2, 3, 4, 5, 6 };
+        uint8_t dst[6];
+        Resample::area(src, 3, 2, 1, dst, 3, 2);
+        BOOST_CHECK(std::equal(src, src + 6, dst));
+    }
+
+    // 2x downscale is the rounded average of 2x2 blocks
+    {
+        uint8_t const src[] = { 0, 1, 10, 20,
+                                2, 3, 30, 40 };
+        uint8_t dst[2];
+        Resample::area(src, 4, 2, 1, dst, 2, 1);
+        BOOST_CHECK_EQUAL(dst[0], 2); // 1.5 rounded up
+        BOOST_CHECK_EQUAL(dst[1], 25);
+    }
+
+    // components are kept apart
+    {
+        uint8_t const src[] = { 10, 0, 200,  20, 0, 100 };
+        uint8_t dst[3];
+        Resample::area(src, 2, 1, 3, dst, 1, 1);
+        BOOST_CHECK_EQUAL(dst[0], 15);
+        BOOST_CHECK_EQUAL(dst[1], 0);
+        BOOST_CHECK_EQUAL(dst[2], 150);
+    }
+
+    // non integer ratios, up and down, keep a constant image constant
+    {
+        std::vector<uint8_t> src(7*5*3, 77);
+        for (auto const & size: { std::make_pair(3, 2), std::make_pair(5, 7), std::make_pair(16, 11), std::make_pair(1, 1) })
+        {
+            std::vector<uint8_t> dst(size.first*size.second*3);
+            Resample::area(src.data(), 7, 5, 3, dst.data(), size.first, size.second);
+            BOOST_CHECK(std::count(dst.begin(), dst.end(), 77) == static_cast<int>(dst.size()));
+        }
+    }
+
+    // fused conversion is the same as conversion followed by resampling
+    {
+        int const w = 37;
+        int const h = 29;
+        std::vector<uint16_t> rgb565(w*h);
+        for (std::size_t i=0; i<rgb565.size(); ++i)
+        {
+            rgb565[i] = static_cast<uint16_t>(i*2654435761u >> 7);
+        }
+        std::vector<uint8_t> rgb(w*h*3);
+        PixelKernels::rgb565ToRgb(rgb565.data(), rgb.data(), rgb565.size());
+
+        std::vector<uint8_t> expected(10*8*3);
+        Resample::area(rgb.data(), w, h, 3, expected.data(), 10, 8);
+
+        std::vector<uint8_t> fused(10*8*3);
+        PixelKernels::rgb565ToRgbResampled(rgb565.data(), w, h, fused.data(), 10, 8);
+        BOOST_CHECK(fused == expected);
+    }
+
+    BOOST_CHECK_THROW(Resample::area(0, 0, 1, 1, 0, 1, 1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testStringTableSortKey)
+{
+    auto const less = [](std::string const & a, std::string const & b, StringTableColumnDef::SortKind kind)
+    {
+        return StringTable::sortKey(a, kind) < StringTable::sortKey(b, kind);
+    };
+    auto const equal = [](std::string const & a, std::string const & b, StringTableColumnDef::SortKind kind)
+    {
+        return StringTable::sortKey(a, kind) == StringTable::sortKey(b, kind);
+    };
+
+    // text, case insensitive
+    BOOST_CHECK(less("abc", "ABD", StringTableColumnDef::SK_TEXT));
+    BOOST_CHECK(equal("abc", "ABC", StringTableColumnDef::SK_TEXT));
+    BOOST_CHECK(less("10", "9", StringTableColumnDef::SK_TEXT));
+
+    // integer on leading number
+    BOOST_CHECK(less("9", "10", StringTableColumnDef::SK_INTEGER));
+    BOOST_CHECK(less(" 9  1/16", "10  2/16", StringTableColumnDef::SK_INTEGER));
+    BOOST_CHECK(less("-5", "3", StringTableColumnDef::SK_INTEGER));
+    BOOST_CHECK(less("", "0", StringTableColumnDef::SK_INTEGER));
+    BOOST_CHECK(less("abc", "-100", StringTableColumnDef::SK_INTEGER));
+    BOOST_CHECK(less("5 a", "5 b", StringTableColumnDef::SK_INTEGER));
+
+    // natural
+    BOOST_CHECK(less("map v9", "map v10", StringTableColumnDef::SK_NATURAL));
+    BOOST_CHECK(less("104.0", "104.0.1", StringTableColumnDef::SK_NATURAL));
+    BOOST_CHECK(less("98.0", "104.0", StringTableColumnDef::SK_NATURAL));
+    BOOST_CHECK(equal("v007", "V7", StringTableColumnDef::SK_NATURAL));
+    BOOST_CHECK(less("a 1", "a b", StringTableColumnDef::SK_NATURAL)); // digits before letters
+    BOOST_CHECK(less("a 1", "a1", StringTableColumnDef::SK_NATURAL)); // space before digits
+    BOOST_CHECK(less(" 2", "s 1", StringTableColumnDef::SK_NATURAL)); // players before spectators
+    BOOST_CHECK(less("s 2", "s10", StringTableColumnDef::SK_NATURAL));
+    BOOST_CHECK(less("x", "x0", StringTableColumnDef::SK_NATURAL));
+}
+
+BOOST_AUTO_TEST_CASE(testMapInfo)
+{
+    MapInfo mi;
+    mi.name_ = "Map Name";
+    mi.fileName_ = "map.sd7";
+    mi.description_ = std::string("desc with \0 and\nnewline", 24);
+    mi.author_ = "author";
+    mi.checksum_ = 0xdeadbeef;
+    mi.width_ = 8192;
+    mi.height_ = 4096;
+    mi.tidalStrength_ = 20;
+    mi.windMin_ = 0;
+    mi.windMax_ = -1;
+    mi.gravity_ = 130;
+    mi.hasMetalSpots_ = true;
+    MetalSpots::Spot const spot = { 0.25f, 0.5f, 3.5f, 12 };
+    mi.metalSpots_.push_back(spot);
+
+    // binary round trip
+    {
+        std::string data;
+        mi.serialize(data);
+
+        MapInfo mi2;
+        mi2.unserialize(data.data(), data.size());
+        BOOST_CHECK(mi == mi2);
+        BOOST_CHECK_EQUAL(mi.checksum_, mi2.checksum_);
+
+        BOOST_CHECK_THROW(mi2.unserialize(data.data(), data.size() - 1), std::runtime_error);
+        data[0] = 99; // version
+        BOOST_CHECK_THROW(mi2.unserialize(data.data(), data.size()), std::runtime_error);
+    }
+
+    // text round trip, metal spots are not in text format
+    {
+        mi.description_ = "desc";
+        mi.hasMetalSpots_ = false;
+        mi.metalSpots_.clear();
+        std::stringstream ss;
+        ss << mi;
+
+        MapInfo mi2;
+        ss >> mi2;
+        BOOST_CHECK(mi == mi2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testGameInfo)
+{
+    GameInfo gi;
+    gi.name_ = "Game v1.0";
+    gi.checksum_ = 0x12345678;
+    AI ai;
+    ai.name_ = "KAIK";
+    ai.info_["shortName"] = "KAIK";
+    ai.info_["version"] = "0.13";
+    ai.info_["description"] = std::string("with \0 and\nnewline", 19);
+    gi.ais_.push_back(ai);
+    ai.name_ = "NullAI";
+    ai.info_.clear();
+    ai.info_["shortName"] = "NullAI";
+    gi.ais_.push_back(ai);
+    gi.sideNames_ = { "arm", "core" };
+    gi.hasOptions_ = true;
+    GameInfo::Option option;
+    option.key_ = "startmetal";
+    option.name_ = "Start Metal";
+    option.type_ = GameInfo::OT_NUMBER;
+    option.default_ = "1000";
+    gi.options_.push_back(option);
+    option = GameInfo::Option();
+    option.key_ = "deathmode";
+    option.type_ = GameInfo::OT_LIST;
+    option.default_ = "com";
+    option.listItems_ = { { "com", "Kill all commanders" }, { "killall", "Kill everything" } };
+    gi.options_.push_back(option);
+
+    BOOST_REQUIRE(gi.findOption("DeathMode"));
+    BOOST_CHECK_EQUAL("Kill everything", gi.findOption("deathmode")->valueText("KillAll"));
+    BOOST_CHECK_EQUAL("unknown", gi.findOption("deathmode")->valueText("unknown"));
+    BOOST_CHECK_EQUAL("5", gi.findOption("startmetal")->valueText("5"));
+    BOOST_CHECK(gi.findOption("missing") == 0);
+
+    std::string data;
+    gi.serialize(data);
+
+    GameInfo gi2;
+    gi2.unserialize(data.data(), data.size());
+    BOOST_CHECK(gi == gi2);
+    BOOST_REQUIRE_EQUAL(2, gi2.ais_.size());
+    BOOST_CHECK_EQUAL("0.13", gi2.ais_[0].info_["version"]);
+
+    BOOST_CHECK_THROW(gi2.unserialize(data.data(), data.size() - 1), std::runtime_error);
+    BOOST_CHECK(gi == gi2); // unchanged on error
+    data[0] = 99; // version
+    BOOST_CHECK_THROW(gi2.unserialize(data.data(), data.size()), std::runtime_error);
+
+    GameInfo empty;
+    empty.hasOptions_ = true; // always true after unserialize of current version
+    data.clear();
+    empty.serialize(data);
+    gi2.unserialize(data.data(), data.size());
+    BOOST_CHECK(empty == gi2);
+
+    // version 1 has no options, version 2 appended them
+    GameInfo noOptions = gi;
+    noOptions.options_.clear();
+    data.clear();
+    noOptions.serialize(data);
+    std::string v1 = data.substr(0, data.size() - sizeof(uint32_t)); // drop option count
+    v1[0] = 1;
+    gi2.unserialize(v1.data(), v1.size());
+    BOOST_CHECK(!gi2.hasOptions_);
+    BOOST_CHECK(gi2.options_.empty());
+    BOOST_CHECK(gi2.sideNames_ == gi.sideNames_);
+}
+
+BOOST_AUTO_TEST_CASE(testMapFilter)
+{
+    MapInfo small;
+    small.author_ = "Someone";
+    small.width_ = 8*512;
+    small.height_ = 8*512;
+    small.windMin_ = 0;
+    small.windMax_ = 10;
+    small.tidalStrength_ = 15;
+    small.gravity_ = 100;
+    small.hasMetalSpots_ = true;
+    small.metalSpots_.resize(8);
+
+    MapInfo big = small;
+    big.author_ = "Other";
+    big.width_ = 24*512;
+    big.height_ = 16*512;
+    big.windMin_ = 15;
+    big.windMax_ = 25;
+    big.gravity_ = 130;
+    big.hasMetalSpots_ = false;
+    big.metalSpots_.clear();
+
+    MapFilter filter;
+    filter.add("DeltaSiegeDry", &small);
+    filter.add("Comet Catcher Redux", &big);
+    filter.add("Delta Noinfo", 0);
+    BOOST_CHECK_EQUAL(3, filter.size());
+
+    auto check = [&filter](std::string const & text, std::vector<int> const & expected)
+    {
+        std::vector<int> const & res = filter.filter(text);
+        BOOST_CHECK_MESSAGE(res == expected, "filter '" << text << "'");
+    };
+
+    check("", {0, 1, 2});
+    check("d", {0, 1, 2});
+    check("de", {0, 2}); // narrows
+    check("delta", {0, 2});
+    check("deltas", {0});
+    check("delta", {0, 2}); // widens
+    check("DELTA someone", {0});
+    check("other", {1});
+    check("size:", {0, 1, 2}); // incomplete range ignored
+    check("size:8", {0});
+    check("size:8-", {0, 1});
+    check("size:-16", {0});
+    check("size:16-24", {1});
+    check("wind:12-", {1});
+    check("wind:5-20", {0, 1});
+    check("tidal:15", {0, 1});
+    check("gravity:120-140 comet", {1});
+    check("gravity:abc", {0, 1, 2}); // bad range ignored
+    check("metal:8", {0}); // unknown spots on big
+    check("nomatch", {});
+
+    // info cached later
+    check("size:8", {0});
+    filter.update(2, &small);
+    check("size:8", {0, 2});
+    check("delta someone", {0, 2});
+    filter.update(2, &big);
+    check("delta someone", {0});
+    check("delta other", {2});
+    filter.update(2, 0);
+    check("delta", {0, 2});
+    check("size:", {0, 1, 2});
+    check("size:1-", {0, 1});
+}
+
+BOOST_AUTO_TEST_CASE(testBattleFilter)
+{
+    auto makeBattle = [](std::string const & opened)
+    {
+        std::istringstream is(opened);
+        return std::unique_ptr<Battle>(new Battle(is));
+    };
+    // id replay nat founder ip port maxPlayers passworded rank mapHash, then engine, version, map, title, game
+    auto zk = makeBattle("1 0 0 Host 1.2.3.4 8452 16 0 0 1 spring\t104.0\tComet Catcher Redux\tNoobs welcome\tZero-K v1.8");
+    auto ba = makeBattle("2 0 0 Other 1.2.3.4 8452 16 1 0 2 spring\t105.0\tDeltaSiegeDry\tPro 1v1\tBalanced Annihilation V9");
+
+    BattleFilter filter(
+        [](std::string const & map, unsigned int) { return map == "DeltaSiegeDry"; },
+        [](std::string const & game, unsigned int) { return true; });
+
+    auto check = [&](std::string const & text, bool zkMatch, bool baMatch)
+    {
+        filter.set(text);
+        BOOST_CHECK_MESSAGE(filter.match(*zk) == zkMatch && filter.match(*ba) == baMatch, "filter '" << text << "'");
+    };
+
+    check("", true, true);
+    check("zero", true, false);
+    check("ZERO,annihilation", true, true);
+    check("zero, annihilation", true, true); // old game filter format
+    check("zero,", true, false);
+    check("game:balanced", false, true);
+    check("-zero", false, true);
+    check("map:comet", true, false);
+    check("engine:105", false, true);
+    check("title:noobs", true, false);
+    check("title:other", false, true); // host
+    check("is:passworded", false, true);
+    check("-is:passworded", true, false);
+    check("is:running", false, false);
+    check("has:map", false, true);
+    check("has:game has:map", false, true);
+    check("players:", true, true); // incomplete range ignored
+    check("players:1-", false, false);
+    check("players:-4", true, true);
+    check("zero map:delta", false, false);
+
+    filter.set("", 1, false);
+    BOOST_CHECK(!filter.match(*zk));
+    filter.set("", 0, true);
+    BOOST_CHECK(!filter.match(*zk));
+    BOOST_CHECK(filter.match(*ba));
+}
+
+BOOST_AUTO_TEST_CASE(testContentIndex)
+{
+    ContentIndex index;
+    index.addMap("Comet Catcher Redux", 0x1234);
+    index.addGame("Zero-K v1.0", 0xabcd);
+    index.addGame("Missing Game", 0);
+
+    BOOST_CHECK_EQUAL(0x1234, index.mapChecksum("Comet Catcher Redux"));
+    BOOST_CHECK_EQUAL(0, index.mapChecksum("comet catcher redux"));
+    BOOST_CHECK_EQUAL(1, index.mapCount());
+
+    BOOST_CHECK(index.knowsGame("Zero-K v1.0"));
+    BOOST_CHECK(index.knowsGame("Missing Game"));
+    BOOST_CHECK(!index.knowsGame("Other Game"));
+    BOOST_CHECK_EQUAL(0xabcd, index.gameChecksum("Zero-K v1.0"));
+    BOOST_CHECK_EQUAL(0, index.gameChecksum("Missing Game"));
+
+    BOOST_CHECK(ContentIndex::matches(0x1234, 0));
+    BOOST_CHECK(ContentIndex::matches(0x1234, 0x1234));
+    BOOST_CHECK(!ContentIndex::matches(0x1234, 0x4321));
+    BOOST_CHECK(!ContentIndex::matches(0, 0));
+
+    index.clear();
+    BOOST_CHECK_EQUAL(0, index.mapChecksum("Comet Catcher Redux"));
+    BOOST_CHECK(!index.knowsGame("Zero-K v1.0"));
+}
+
+BOOST_AUTO_TEST_CASE(testContentWatcher)
+{
+    BOOST_CHECK(ContentWatcher::isArchive("map.sd7"));
+    BOOST_CHECK(ContentWatcher::isArchive("Game.SDZ"));
+    BOOST_CHECK(ContentWatcher::isArchive("0123abcd.sdp"));
+    BOOST_CHECK(!ContentWatcher::isArchive("map.sd7.tmp"));
+    BOOST_CHECK(!ContentWatcher::isArchive(".hidden.sd7"));
+
+    ContentWatcher watcher;
+    if (watcher.fd() < 0)
+    {
+        BOOST_TEST_MESSAGE("inotify not available, skipping watch test");
+        return;
+    }
+
+    std::string const dataDir = "ContentWatcherTestDir/";
+    boost::filesystem::remove_all(dataDir);
+    boost::filesystem::create_directories(dataDir + "maps");
+
+    watcher.watch({ dataDir });
+    BOOST_CHECK(watcher.readChanges().empty());
+
+    std::ofstream(dataDir + "maps/a.sd7") << "a";
+    std::ofstream(dataDir + "maps/b.txt") << "b";
+    std::vector<std::string> changes = watcher.readChanges();
+    BOOST_REQUIRE_EQUAL(1, changes.size());
+    BOOST_CHECK_EQUAL(dataDir + "maps/a.sd7", changes[0]);
+
+    boost::filesystem::remove(dataDir + "maps/a.sd7");
+    BOOST_CHECK_EQUAL(1, watcher.readChanges().size());
+
+    // games dir created after watch started
+    boost::filesystem::create_directories(dataDir + "games");
+    BOOST_CHECK(watcher.readChanges().empty());
+    std::ofstream(dataDir + "games/g.sdz") << "g";
+    changes = watcher.readChanges();
+    BOOST_REQUIRE_EQUAL(1, changes.size());
+    BOOST_CHECK_EQUAL(dataDir + "games/g.sdz", changes[0]);
+
+    boost::filesystem::remove_all(dataDir);
+}
+
+BOOST_AUTO_TEST_CASE(testPackFile)
+{
+    std::string const fileName("PackTestFile");
+    std::remove(fileName.c_str());
+
+    std::string const a(100, 'a');
+    std::string const b("bbb");
+
+    uint8_t const * aData = 0;
+    {
+        PackFile pack(fileName);
+        BOOST_CHECK_EQUAL(0, pack.count());
+
+        pack.put("a", a.data(), a.size());
+        pack.put("b", "x", 1);
+        pack.put("b", b.data(), b.size()); // replaces
+        pack.put("c", "c", 1);
+        pack.remove("c");
+
+        std::size_t size = 0;
+        aData = pack.get("a", size);
+        BOOST_REQUIRE(aData != 0);
+        BOOST_CHECK_EQUAL(a, std::string(reinterpret_cast<char const*>(aData), size));
+        BOOST_CHECK(pack.get("c", size) == 0);
+        BOOST_CHECK_EQUAL(2, pack.count());
+        BOOST_CHECK(pack.garbageSize() > 0);
+
+        // pointers stay valid after compaction
+        pack.compact();
+        BOOST_CHECK_EQUAL(0, pack.garbageSize());
+        BOOST_CHECK_EQUAL(a, std::string(reinterpret_cast<char const*>(aData), a.size()));
+        BOOST_CHECK(pack.has("a"));
+        BOOST_CHECK(pack.has("b"));
+    }
+
+    // reopen, records are loaded from file
+    std::size_t fileSize = 0;
+    {
+        PackFile pack(fileName);
+        std::size_t size = 0;
+        uint8_t const * bData = pack.get("b", size);
+        BOOST_REQUIRE(bData != 0);
+        BOOST_CHECK_EQUAL(b, std::string(reinterpret_cast<char const*>(bData), size));
+        BOOST_CHECK_EQUAL(2, pack.count());
+        fileSize = pack.fileSize();
+    }
+
+    // partially written record is dropped
+    {
+        std::ofstream ofs(fileName, std::ios::app | std::ios::binary);
+        ofs << "garbage";
+    }
+    {
+        PackFile pack(fileName);
+        BOOST_CHECK_EQUAL(2, pack.count());
+        BOOST_CHECK_EQUAL(fileSize, pack.fileSize());
+    }
+
+    // changes by another instance are picked up by reload
+    {
+        PackFile pack(fileName);
+        {
+            PackFile other(fileName);
+            other.remove("a");
+            other.compact();
+            BOOST_CHECK_EQUAL(1, other.count());
+        }
+        BOOST_CHECK(pack.has("a"));
+        pack.reload();
+        BOOST_CHECK(!pack.has("a"));
+        BOOST_CHECK(pack.has("b"));
+        BOOST_CHECK_EQUAL(0, pack.garbageSize());
+    }
+
+    // file with bad header is replaced, not truncated under other readers
+    {
+        std::ofstream ofs(fileName, std::ios::trunc | std::ios::binary);
+        ofs << "not a pack file header";
+    }
+    {
+        std::ifstream old(fileName, std::ios::binary);
+        PackFile pack(fileName);
+        BOOST_CHECK_EQUAL(0, pack.count());
+        pack.put("a", a.data(), a.size());
+        BOOST_CHECK(pack.has("a"));
+
+        old.seekg(0, std::ios::end);
+        BOOST_CHECK_EQUAL(22, old.tellg());
+    }
+
+    std::remove(fileName.c_str());
+}
+
 static
 void logThread(int id)
 {
@@ -609,6 +1285,215 @@ BOOST_AUTO_TEST_CASE(testTextFunctions)
     }
 }
 
+BOOST_AUTO_TEST_CASE(testNameIndex)
+{
+    NameIndex index;
+    BOOST_CHECK_EQUAL("", index.complete("a"));
+
+    for (auto const & name : { "Habc", "abc", "ABd", "Hagf", "aGF", "[tag]abx" })
+    {
+        index.addUnsorted(name);
+    }
+    BOOST_CHECK_EQUAL(6, index.size());
+
+    BOOST_CHECK_EQUAL("", index.complete(""));
+    BOOST_CHECK_EQUAL("", index.complete("GHabc"));
+    BOOST_CHECK_EQUAL("abc", index.complete("ab"));
+    BOOST_CHECK_EQUAL("aGF", index.complete("ag"));
+    BOOST_CHECK_EQUAL("abc", index.complete("BC"));
+    BOOST_CHECK_EQUAL("aGF", index.complete("gf"));
+    BOOST_CHECK_EQUAL("Habc", index.complete("h"));
+
+    // cycling, prefix matches first then names containing text
+    BOOST_CHECK_EQUAL("ABd", index.complete("ab", "abc"));
+    BOOST_CHECK_EQUAL("Habc", index.complete("ab", "ABd"));
+    BOOST_CHECK_EQUAL("[tag]abx", index.complete("ab", "Habc"));
+    BOOST_CHECK_EQUAL("abc", index.complete("ab", "[tag]abx")); // wraps
+    BOOST_CHECK_EQUAL("", index.complete("ab", "Hagf")); // not a match
+
+    index.remove("abc");
+    index.remove("unknown");
+    BOOST_CHECK_EQUAL(5, index.size());
+    BOOST_CHECK_EQUAL("ABd", index.complete("ab"));
+    BOOST_CHECK_EQUAL("ABd", index.complete("ab", "[tag]abx"));
+
+    index.add("abc");
+    BOOST_CHECK_EQUAL("abc", index.complete("ab"));
+
+    index.clear();
+    BOOST_CHECK_EQUAL(0, index.size());
+    BOOST_CHECK_EQUAL("", index.complete("ab"));
+
+    // sorted inserts
+    index.add("Bc");
+    index.add("bA");
+    index.add("a");
+    BOOST_CHECK_EQUAL("bA", index.complete("b"));
+    BOOST_CHECK_EQUAL("Bc", index.complete("b", "bA"));
+    index.remove("bA");
+    BOOST_CHECK_EQUAL("Bc", index.complete("b"));
+}
+
+BOOST_AUTO_TEST_CASE(testChatBuffer)
+{
+    // one unit per char, wraps every width chars
+    ChatBuffer buffer([](ChatBuffer::Line const & line, int width)
+    {
+        std::vector<std::size_t> breaks;
+        for (std::size_t pos = width; pos < line.text_.size(); pos += width)
+        {
+            breaks.push_back(pos);
+        }
+        return breaks;
+    }, 4);
+    typedef std::pair<std::size_t, std::size_t> LineRow;
+
+    BOOST_CHECK(buffer.empty());
+    BOOST_CHECK_EQUAL(0, buffer.rows());
+
+    // not wrapped until width is known
+    buffer.append("12:00 hello", 6, 2);
+    BOOST_CHECK_EQUAL(1, buffer.rows());
+    buffer.width(5);
+    BOOST_CHECK_EQUAL(3, buffer.rows());
+    BOOST_CHECK_EQUAL(5, buffer.line(0).rowEnd(0));
+    BOOST_CHECK_EQUAL(10, buffer.line(0).rowBegin(2));
+    BOOST_CHECK_EQUAL(11, buffer.line(0).rowEnd(2));
+
+    for (int i = 1; i < 10; ++i)
+    {
+        buffer.append(std::string(i, 'x'), 0, 2);
+    }
+    BOOST_CHECK_EQUAL(0, buffer.firstLine());
+    BOOST_CHECK_EQUAL(10, buffer.endLine());
+    BOOST_CHECK_EQUAL(11 + 45, buffer.chars());
+    BOOST_CHECK_EQUAL(3 + 5*1 + 4*2, buffer.rows());
+
+    BOOST_CHECK(LineRow(0, 2) == buffer.findRow(2));
+    BOOST_CHECK(LineRow(1, 0) == buffer.findRow(3));
+    BOOST_CHECK(LineRow(9, 1) == buffer.findRow(buffer.rows() - 1));
+    BOOST_CHECK_EQUAL(3, buffer.rowOf(1));
+    BOOST_CHECK_EQUAL(buffer.rows() - 2, buffer.rowOf(9));
+    BOOST_CHECK_THROW(buffer.findRow(buffer.rows()), std::out_of_range);
+
+    // drops whole chunks of 4 lines while the rest has enough chars, last chunk is kept
+    BOOST_CHECK_EQUAL(0, buffer.trim(1000));
+    std::size_t const rows = buffer.rows();
+    BOOST_CHECK_EQUAL(3 + 3, buffer.trim(30)); // lines 0-3
+    BOOST_CHECK_EQUAL(4, buffer.firstLine());
+    BOOST_CHECK_EQUAL(rows - 6, buffer.rows());
+    BOOST_CHECK_EQUAL("xxxx", buffer.line(4).text_);
+    BOOST_CHECK_THROW(buffer.line(3), std::out_of_range);
+    BOOST_CHECK(LineRow(4, 0) == buffer.findRow(0));
+    BOOST_CHECK_EQUAL(0, buffer.rowOf(4));
+    BOOST_CHECK_EQUAL(1 + 1 + 2 + 2, buffer.trim(0)); // lines 4-7
+    BOOST_CHECK_EQUAL(8, buffer.firstLine());
+    BOOST_CHECK_EQUAL(0, buffer.trim(0));
+
+    buffer.width(3);
+    BOOST_CHECK_EQUAL(3 + 3, buffer.rows());
+
+    buffer.clear();
+    BOOST_CHECK(buffer.empty());
+    BOOST_CHECK_EQUAL(0, buffer.rows());
+    BOOST_CHECK_EQUAL(10, buffer.firstLine());
+    buffer.append("abcd", 0, 2);
+    BOOST_CHECK_EQUAL(2, buffer.rows());
+    BOOST_CHECK_EQUAL("abcd", buffer.line(10).text_);
+
+    // prepended lines fill the first chunk from its end, numbers of later lines shift
+    for (int i = 1; i < 7; ++i)
+    {
+        buffer.prepend(std::string(i, 'p'), 0, 2, i, i + 1);
+    }
+    BOOST_CHECK_EQUAL(10, buffer.firstLine());
+    BOOST_CHECK_EQUAL(17, buffer.endLine());
+    BOOST_CHECK_EQUAL("pppppp", buffer.line(10).text_);
+    BOOST_CHECK_EQUAL("p", buffer.line(15).text_);
+    BOOST_CHECK_EQUAL(1, buffer.line(15).logBegin_);
+    BOOST_CHECK_EQUAL("abcd", buffer.line(16).text_);
+    BOOST_CHECK_EQUAL(3*2 + 3*1 + 2, buffer.rows());
+    BOOST_CHECK_EQUAL(3*2 + 3*1, buffer.rowOf(16));
+    BOOST_CHECK(LineRow(16, 1) == buffer.findRow(buffer.rows() - 1));
+    buffer.append("xyz", 0, 2);
+    BOOST_CHECK_EQUAL("xyz", buffer.line(17).text_);
+
+    // drops newest chunks: "abcd" "xyz" then "p" "pp" "ppp" "pppp"
+    BOOST_CHECK_EQUAL(0, buffer.trimBack(1000));
+    BOOST_CHECK_EQUAL(2 + 1 + 1 + 1 + 1 + 2, buffer.trimBack(0));
+    BOOST_CHECK_EQUAL(12, buffer.endLine());
+    BOOST_CHECK_EQUAL("ppppp", buffer.line(11).text_);
+    BOOST_CHECK_EQUAL(0, buffer.trimBack(0));
+}
+
+BOOST_AUTO_TEST_CASE(testLogReader)
+{
+    std::string const fileName("LogTestFile");
+    {
+        std::ofstream ofs(fileName);
+        ofs << "2020-01-02 10:00:00: first\n"
+            << "\n"
+            << "NEW LOG SESSION 2020-01-03 11:00:00\n"
+            << "2020-01-03 11:00:01: second: with colon\n"
+            << "2020-01-03 11:00:02: third\n"
+            << "2020-01-03 11:00:03: part"; // not complete yet
+    }
+
+    LogReader reader(fileName);
+    std::size_t const size = reader.size();
+    BOOST_CHECK_EQUAL(27 + 1 + 36 + 40 + 27, size);
+
+    // backwards from end, lines that are not log text are scanned but skipped
+    std::vector<LogReader::Line> lines;
+    std::size_t pos = reader.linesBefore(size, 2, lines);
+    BOOST_REQUIRE_EQUAL(2, lines.size());
+    BOOST_CHECK_EQUAL("2020-01-03 11:00:01", lines[0].time_);
+    BOOST_CHECK_EQUAL("second: with colon", lines[0].text_);
+    BOOST_CHECK_EQUAL("third", lines[1].text_);
+    BOOST_CHECK_EQUAL(pos, lines[0].begin_);
+    BOOST_CHECK_EQUAL(size, lines[1].end_);
+
+    lines.clear();
+    pos = reader.linesBefore(pos, 2, lines);
+    BOOST_CHECK_EQUAL(27, pos);
+    BOOST_CHECK(lines.empty());
+    pos = reader.linesBefore(pos, 2, lines);
+    BOOST_CHECK_EQUAL(0, pos);
+    BOOST_REQUIRE_EQUAL(1, lines.size());
+    BOOST_CHECK_EQUAL("first", lines[0].text_);
+    BOOST_CHECK_EQUAL(0, reader.linesBefore(0, 2, lines));
+
+    // offsets inside a line move to a line start
+    lines.clear();
+    BOOST_CHECK_EQUAL(0, reader.linesBefore(10, 1, lines));
+    BOOST_CHECK(lines.empty());
+    pos = reader.linesAfter(10, 3, lines);
+    BOOST_CHECK_EQUAL(27 + 1 + 36 + 40, pos);
+    BOOST_REQUIRE_EQUAL(1, lines.size());
+    BOOST_CHECK_EQUAL("second: with colon", lines[0].text_);
+    BOOST_CHECK_EQUAL(size, reader.linesAfter(pos, 3, lines));
+    BOOST_CHECK_EQUAL(size, reader.linesAfter(size, 3, lines));
+
+    // picks up appended lines
+    {
+        std::ofstream ofs(fileName, std::fstream::app);
+        ofs << "\n";
+    }
+    reader.update();
+    BOOST_CHECK_EQUAL(size + 26, reader.size());
+    lines.clear();
+    reader.linesAfter(size, 3, lines);
+    BOOST_REQUIRE_EQUAL(1, lines.size());
+    BOOST_CHECK_EQUAL("part", lines[0].text_);
+
+    LogReader::Line line;
+    std::string const bad("2020-01-03 11:00:0x: bad");
+    BOOST_CHECK(!LogReader::parse(bad.data(), bad.data() + bad.size(), line));
+
+    std::remove(fileName.c_str());
+    BOOST_CHECK_THROW(LogReader("LogTestFileNotThere"), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(testFlobbyDirs)
 {
     {